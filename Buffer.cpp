@@ -0,0 +1,25 @@
+#include "Buffer.h"
+#include "BufferPool.h"
+#include <new>
+
+/**
+ * Выделение блока с заданной емкостью
+ * @param capacity Минимальный размер области данных в байтах
+ * @return Блок со счетчиком ссылок, равным 1
+ */
+BufferBlock* BufferBlock::create(size_t capacity) {
+    uint32_t sizeClass;
+    void* mem = BufferPool::allocate(sizeof(BufferBlock), capacity, sizeClass);
+    return new (mem) BufferBlock(capacity, sizeClass);
+}
+
+/**
+ * Освобождение ссылки; последняя ссылка освобождает память блока
+ */
+void BufferBlock::release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        uint32_t sizeClass = sizeClass_;
+        this->~BufferBlock();
+        BufferPool::deallocate(this, sizeClass);
+    }
+}
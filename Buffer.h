@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Блок памяти с атомарным счетчиком ссылок
+ * Данные располагаются сразу за заголовком в одной аллокации из BufferPool,
+ * емкость округляется до класса размера пула.
+ * Блок разделяется между входным буфером соединения и очередями ответов,
+ * что позволяет отправлять принятые байты без копирования
+ */
+class BufferBlock {
+public:
+    static BufferBlock* create(size_t capacity);
+
+    void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void release();
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    size_t capacity() const { return capacity_; }
+    bool unique() const { return refs_.load(std::memory_order_acquire) == 1; }
+
+private:
+    BufferBlock(size_t capacity, uint32_t sizeClass) : sizeClass_(sizeClass), capacity_(capacity) {}
+
+    std::atomic<uint32_t> refs_{1};
+    uint32_t sizeClass_;        ///< Класс размера BufferPool
+    size_t capacity_;
+};
+
+/**
+ * Владеющая ссылка на BufferBlock (аналог shared_ptr без отдельного control block)
+ */
+class BufferRef {
+public:
+    BufferRef() = default;
+    /// Принимает уже учтенную ссылку (например, результат BufferBlock::create)
+    explicit BufferRef(BufferBlock* block) : block_(block) {}
+    BufferRef(const BufferRef& other) : block_(other.block_) { if (block_) block_->retain(); }
+    BufferRef(BufferRef&& other) noexcept : block_(other.block_) { other.block_ = nullptr; }
+    ~BufferRef() { if (block_) block_->release(); }
+
+    BufferRef& operator=(BufferRef other) noexcept {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+
+    BufferBlock* get() const { return block_; }
+    BufferBlock* operator->() const { return block_; }
+    explicit operator bool() const { return block_ != nullptr; }
+    bool operator==(const BufferRef& other) const { return block_ == other.block_; }
+
+    static BufferRef allocate(size_t capacity) { return BufferRef(BufferBlock::create(capacity)); }
+
+private:
+    BufferBlock* block_ = nullptr;
+};
@@ -0,0 +1,136 @@
+#include "BufferPool.h"
+#include "Metrics.h"
+#include <mutex>
+#include <new>
+
+/// Списки свободных блоков потока; при завершении потока блоки возвращаются в общий список
+struct BufferPool::LocalCache {
+    FreeList lists[CLASSES];
+    ~LocalCache();
+};
+
+/// Общие списки свободных блоков
+struct BufferPool::SharedLists {
+    std::mutex mutex;
+    FreeList lists[CLASSES];
+};
+
+void BufferPool::FreeList::push(void* mem) {
+    auto* node = static_cast<FreeNode*>(mem);
+    node->next = head;
+    head = node;
+    ++count;
+}
+
+void* BufferPool::FreeList::pop() {
+    FreeNode* node = head;
+    if (!node) return nullptr;
+    head = node->next;
+    --count;
+    return node;
+}
+
+BufferPool::LocalCache::~LocalCache() {
+    SharedLists& s = shared();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (uint32_t c = 0; c < CLASSES; ++c) {
+        while (void* mem = lists[c].pop()) {
+            if (s.lists[c].count * classCapacity(c) < SHARED_BYTES) s.lists[c].push(mem);
+            else ::operator delete(mem);
+        }
+    }
+}
+
+BufferPool::LocalCache& BufferPool::local() {
+    thread_local LocalCache cache;
+    return cache;
+}
+
+BufferPool::SharedLists& BufferPool::shared() {
+    // Не уничтожается при выходе: потоки могут завершаться позже статических объектов
+    static auto* lists = new SharedLists();
+    return *lists;
+}
+
+/**
+ * Класс размера для емкости
+ * @return Номер класса или NO_CLASS, если емкость больше MAX_CLASS
+ */
+uint32_t BufferPool::classOf(size_t capacity) {
+    if (capacity > MAX_CLASS) return NO_CLASS;
+    uint32_t c = 0;
+    while (classCapacity(c) < capacity) ++c;
+    return c;
+}
+
+/**
+ * Сколько блоков класса поток держит у себя (не меньше 4)
+ */
+size_t BufferPool::localLimit(uint32_t sizeClass) {
+    size_t limit = LOCAL_BYTES / classCapacity(sizeClass);
+    return limit < 4 ? 4 : limit;
+}
+
+/**
+ * Выделение памяти под блок
+ * @param header Размер заголовка, который располагается перед данными
+ * @param capacity [in/out] Требуемая емкость данных; на выходе - емкость класса
+ * @param sizeClass [out] Класс, который нужно передать в deallocate
+ * @return Память размером header + capacity
+ */
+void* BufferPool::allocate(size_t header, size_t& capacity, uint32_t& sizeClass) {
+    sizeClass = classOf(capacity);
+    if (sizeClass == NO_CLASS) {
+        Metrics::add(Metrics::Counter::MemAllocs);
+        return ::operator new(header + capacity);
+    }
+    capacity = classCapacity(sizeClass);
+
+    FreeList& list = local().lists[sizeClass];
+    if (void* mem = list.pop()) {
+        Metrics::add(Metrics::Counter::MemReused);
+        return mem;
+    }
+
+    // Список потока пуст - забираем половину его предела из общего списка
+    {
+        SharedLists& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        FreeList& from = s.lists[sizeClass];
+        for (size_t n = localLimit(sizeClass) / 2; n > 0 && from.head; --n) list.push(from.pop());
+    }
+    if (void* mem = list.pop()) {
+        Metrics::add(Metrics::Counter::MemReused);
+        return mem;
+    }
+
+    Metrics::add(Metrics::Counter::MemAllocs);
+    return ::operator new(header + capacity);
+}
+
+/**
+ * Возврат памяти блока
+ * Блок кладется в список текущего потока (не обязательно выделившего его);
+ * при переполнении половина списка переносится в общий
+ * @param mem Память, полученная от allocate
+ * @param sizeClass Класс, полученный от allocate
+ */
+void BufferPool::deallocate(void* mem, uint32_t sizeClass) {
+    if (sizeClass == NO_CLASS) {
+        ::operator delete(mem);
+        return;
+    }
+
+    FreeList& list = local().lists[sizeClass];
+    list.push(mem);
+    if (list.count <= localLimit(sizeClass)) return;
+
+    SharedLists& s = shared();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    FreeList& to = s.lists[sizeClass];
+    for (size_t n = list.count / 2; n > 0; --n) {
+        void* spill = list.pop();
+        if (to.count * classCapacity(sizeClass) < SHARED_BYTES) to.push(spill);
+        else ::operator delete(spill);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Пул памяти для блоков буферов с классами размеров
+ * Емкость блока округляется вверх до степени двойки от MIN_CLASS до MAX_CLASS.
+ * Освобожденные блоки попадают в список свободных текущего потока, излишки -
+ * в общий список под блокировкой, откуда их забирают потоки с пустым списком.
+ * В установившемся режиме блоки переиспользуются без обращения к malloc;
+ * промахи пула видны в /stats как MEM allocs, все обращения к куче - как MEM heap
+ */
+class BufferPool {
+public:
+    static constexpr size_t MIN_CLASS = 256;            ///< Наименьший класс (емкость, байт)
+    static constexpr size_t MAX_CLASS = 64 * 1024;      ///< Наибольший класс; крупнее - напрямую из кучи
+    static constexpr uint32_t NO_CLASS = ~uint32_t{0};  ///< Блок вне пула
+
+    static void* allocate(size_t header, size_t& capacity, uint32_t& sizeClass);
+    static void deallocate(void* mem, uint32_t sizeClass);
+
+private:
+    static constexpr size_t CLASSES = 9;                ///< 256 Б ... 64 КБ
+    static constexpr size_t LOCAL_BYTES = 1024 * 1024;  ///< Предел списка потока на класс
+    static constexpr size_t SHARED_BYTES = 16 * 1024 * 1024;   ///< Предел общего списка на класс
+
+    /// Свободный блок: указатель на следующий хранится в его же памяти
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    /// Список свободных блоков одного класса
+    struct FreeList {
+        FreeNode* head = nullptr;
+        size_t count = 0;
+
+        void push(void* mem);
+        void* pop();
+    };
+
+    struct LocalCache;
+    struct SharedLists;
+
+    static uint32_t classOf(size_t capacity);
+    static size_t classCapacity(uint32_t sizeClass) { return MIN_CLASS << sizeClass; }
+    static size_t localLimit(uint32_t sizeClass);
+    static LocalCache& local();
+    static SharedLists& shared();
+};
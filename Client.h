@@ -1,6 +1,15 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 #include <netinet/in.h>
+#include "InputBuffer.h"
+#include "OutputQueue.h"
+#include "Session.h"
+#include "ShmChannel.h"
+#include "TimerWheel.h"
 
 /**
  * Структура для хранения информации о TCP клиенте
@@ -8,7 +17,42 @@
  */
 struct Client
 {
+    /// Формат сообщений соединения
+    enum class Protocol : uint8_t {
+        Text,       ///< Строки до '\n'
+        Binary      ///< Кадры с длиной и кодом операции (Frame.h), после команды /binary
+    };
+
     int fd;                      ///< Файловый дескриптор клиентского сокета
-    sockaddr_in addr;            ///< Адресная информация клиента (IP и порт)
-    std::string buffer;          ///< Буфер для накопления данных от клиента
-};
\ No newline at end of file
+    uint32_t generation = 0;     ///< Поколение слота в таблице соединений (для идентификатора события)
+    int reactor = -1;            ///< Реактор, принявший соединение
+    sockaddr_in addr;            ///< Адресная информация клиента (IP и порт; для Unix сокета - только sin_family)
+    InputBuffer buffer;          ///< Буфер для накопления данных от клиента
+    OutputQueue out;             ///< Очередь ответов, ожидающих отправки
+    Protocol protocol = Protocol::Text;
+    size_t frameMissing = 0;     ///< Байт недостает до конца принимаемого кадра (0 - кадра нет)
+    bool writeArmed = false;     ///< Подписаны ли на EPOLLOUT (буфер сокета был заполнен)
+    bool readPaused = false;     ///< Чтение приостановлено: очередь ответов превысила порог
+    uint64_t acceptedAt = 0;                  ///< Время принятия соединения, мс
+    std::atomic<uint64_t> lastActivity{0};    ///< Последний прием или отправка данных, мс
+    std::atomic<uint64_t> lineStartedAt{0};   ///< Прием начала незавершенной строки, мс (0 - строки нет)
+    TimerWheel::Node timer;                   ///< Таймер в колесе реактора (под Reactor::timersMutex)
+    std::vector<std::string> channels;        ///< Каналы PubSub, на которые подписано соединение
+    Session session;                          ///< Выполняемая многошаговая команда (сопрограмма)
+    std::unique_ptr<ShmChannel> shm;          ///< Кольца в разделяемой памяти вместо сокета (после /shm)
+
+    /// Сброс при закрытии соединения: буферы возвращаются в пул, кольцо очереди ответов остается
+    void reset() {
+        buffer = InputBuffer();
+        out.clear();
+        protocol = Protocol::Text;
+        frameMissing = 0;
+        writeArmed = false;
+        readPaused = false;
+        lastActivity.store(0, std::memory_order_relaxed);
+        lineStartedAt.store(0, std::memory_order_relaxed);
+        channels.clear();
+        session.reset();
+        shm.reset();
+    }
+};
@@ -0,0 +1,346 @@
+#include "Commands.h"
+#include "EpollServer.h"
+#include "FlightRecorder.h"
+#include "Frame.h"
+#include "Metrics.h"
+#include "Utils.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * Приемник ответа TCP соединения
+ * @param client Клиент, отправивший команду
+ * @param opcode Код операции кадра ответа (двоичный протокол)
+ */
+ReplySink::ReplySink(Client& client, uint8_t opcode) :
+    client_(&client), opcode_(opcode), reactor_(client.reactor) {}
+
+/**
+ * Запись ответа команды
+ * @param text Текст ответа без перевода строки
+ */
+void ReplySink::write(std::string_view text) {
+    if (client_ && client_->protocol == Client::Protocol::Binary) {
+        char header[Frame::HEADER];
+        Frame::writeHeader(header, opcode_, static_cast<uint32_t>(text.size()));
+        client_->out.push(header, sizeof(header));
+        client_->out.push(text.data(), text.size());
+    } else if (client_) {
+        client_->out.push(text.data(), text.size());
+        client_->out.push("\n", 1);
+    } else {
+        datagram_->assign(text.data(), text.size());
+    }
+}
+
+/**
+ * Ответ об ошибке разбора команды; в двоичном протоколе уходит кадром Frame::ERROR
+ * @param text Текст ошибки без перевода строки
+ */
+void ReplySink::fail(std::string_view text) {
+    opcode_ = Frame::ERROR;
+    write(text);
+}
+
+namespace {
+
+using Handler = void (*)(EpollServer& server, std::string_view arg, ReplySink& reply);
+using CoHandler = SessionTask (*)(EpollServer& server, Session& session, std::string arg);
+
+/**
+ * Описание команды: имя без '/', обработчик, счетчик вызовов, код операции кадра (0 - только текстом)
+ * и сопрограмма для TCP соединений с текстовым протоколом (nullptr - команда в один шаг)
+ */
+struct Command {
+    std::string_view name;
+    Handler handler;
+    Metrics::Counter counter;
+    uint8_t opcode;
+    CoHandler coHandler = nullptr;
+};
+
+/// /time - текущее время сервера (без временной строки в куче)
+void cmdTime(EpollServer&, std::string_view, ReplySink& reply) {
+    char buf[32];
+    reply.write(std::string_view(buf, formatNow(buf, sizeof(buf))));
+}
+
+/// /stats - статистика сервера
+void cmdStats(EpollServer& server, std::string_view, ReplySink& reply) {
+    reply.write(server.stats());
+}
+
+/**
+ * Служебная команда по UDP: адрес датаграммы можно подделать, поэтому без заданного
+ * --shutdown-token она отклоняется (по TCP и Unix сокету токен по-прежнему необязателен)
+ * @return true, если команда отклонена и ответ уже записан
+ */
+bool udpAdminRefused(EpollServer& server, ReplySink& reply) {
+    if (reply.client() || server.shutdownTokenSet()) return false;
+    reply.write("Over UDP this command needs --shutdown-token");
+    return true;
+}
+
+/// /shutdown [TOKEN] - завершение работы сервера
+void cmdShutdown(EpollServer& server, std::string_view arg, ReplySink& reply) {
+    if (udpAdminRefused(server, reply)) return;
+    reply.write(server.requestShutdown(arg) ? "Server shutting down" : "Invalid token");
+}
+
+/// /shutdown по TCP: без токена, когда он задан, сервер запрашивает его следующей строкой
+SessionTask coShutdown(EpollServer& server, Session& session, std::string token) {
+    if (token.empty() && server.shutdownTokenSet()) {
+        co_await session.write("Token:");
+        token = co_await session.readLine();
+    }
+    co_await session.write(server.requestShutdown(token) ? "Server shutting down" : "Invalid token");
+}
+
+/// /subscribe CHANNEL - подписка отправителя на канал
+void cmdSubscribe(EpollServer& server, std::string_view channel, ReplySink& reply) {
+    if (!PubSub::validChannel(channel)) {
+        reply.write("Invalid channel");
+        return;
+    }
+    bool ok = reply.client() ? server.pubsub().subscribe(channel, *reply.client())
+                             : server.pubsub().subscribe(channel, *reply.peer(), reply.reactor());
+    reply.write(ok ? "Subscribed" : "Too many subscriptions");
+}
+
+/// /unsubscribe [CHANNEL] - отписка от канала, без аргумента - от всех каналов
+void cmdUnsubscribe(EpollServer& server, std::string_view channel, ReplySink& reply) {
+    PubSub& pubsub = server.pubsub();
+    size_t count;
+    if (channel.empty()) {
+        count = reply.client() ? pubsub.unsubscribeAll(*reply.client()) : pubsub.unsubscribeAll(*reply.peer());
+    } else {
+        count = reply.client() ? pubsub.unsubscribe(channel, *reply.client()) : pubsub.unsubscribe(channel, *reply.peer());
+    }
+    reply.write(count > 0 ? "Unsubscribed" : "Not subscribed");
+}
+
+/// /publish CHANNEL MESSAGE - рассылка сообщения подписчикам канала
+void cmdPublish(EpollServer& server, std::string_view arg, ReplySink& reply) {
+    size_t space = arg.find(' ');
+    if (space == std::string_view::npos || space + 1 == arg.size() || !PubSub::validChannel(arg.substr(0, space))) {
+        reply.write("Usage: /publish CHANNEL MESSAGE");
+        return;
+    }
+    size_t receivers = server.pubsub().publish(arg.substr(0, space), arg.substr(space + 1));
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "Published %zu", receivers);
+    reply.write(std::string_view(buf, static_cast<size_t>(n)));
+}
+
+/// /binary - переход соединения на двоичный протокол; байты после команды уже разбираются как кадры
+void cmdBinary(EpollServer&, std::string_view, ReplySink& reply) {
+    Client* c = reply.client();
+    if (!c) {
+        reply.write("Binary mode is TCP only");
+        return;
+    }
+    reply.write("Binary mode");
+    c->protocol = Client::Protocol::Binary;
+}
+
+/// /shm - переход соединения Unix сокета на кольца в разделяемой памяти
+void cmdShm(EpollServer& server, std::string_view, ReplySink& reply) {
+    Client* c = reply.client();
+    if (!c || c->addr.sin_family != AF_UNIX || c->protocol != Client::Protocol::Text) {
+        reply.write("Shared memory is Unix socket only");
+        return;
+    }
+    // Ответ "Shared memory" уходит напрямую через сокет: более ранние ответы не должны его обогнать
+    if (!c->out.empty()) {
+        reply.write("Shared memory: wait for pending replies");
+        return;
+    }
+    if (!server.attachShm(*c)) reply.write("Shared memory unavailable");
+}
+
+/// Не чаще одного дампа по /trace за TRACE_INTERVAL_NS: дамп копирует кольца всех потоков и пишет файл
+constexpr uint64_t TRACE_INTERVAL_NS = 5000000000ull;
+std::atomic<uint64_t> lastTrace{0};
+
+/**
+ * Разрешение очередного дампа по команде
+ * @return false, если предыдущий дамп был меньше TRACE_INTERVAL_NS назад
+ */
+bool traceAllowed() {
+    uint64_t now = FlightRecorder::monotonicNs();
+    uint64_t last = lastTrace.load(std::memory_order_relaxed);
+    if (last != 0 && now - last < TRACE_INTERVAL_NS) return false;
+    return lastTrace.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+/// /trace [TOKEN] - дамп бортового самописца в файл (токен - тот же, что у /shutdown)
+void cmdTrace(EpollServer& server, std::string_view token, ReplySink& reply) {
+    if (udpAdminRefused(server, reply)) return;
+    if (!server.adminToken(token)) {
+        reply.write("Invalid token");
+        return;
+    }
+    std::string path;
+    size_t records;
+    if (!FlightRecorder::enabled()) {
+        reply.write("Trace disabled");
+    } else if (!traceAllowed()) {
+        reply.write("Trace rate limited");
+    } else if (FlightRecorder::dump(path, records)) {
+        reply.write("Trace written: " + path + " (" + std::to_string(records) + " records)");
+    } else {
+        reply.write("Trace failed");
+    }
+}
+
+/// /watch по UDP не выполняется: ответ на датаграмму - одна датаграмма
+void cmdWatch(EpollServer&, std::string_view, ReplySink& reply) {
+    reply.write("Watch is TCP only");
+}
+
+/// /watch [SECONDS] - /stats раз в секунду в течение SECONDS секунд (по умолчанию 10, не больше 3600)
+SessionTask coWatch(EpollServer& server, Session& session, std::string arg) {
+    long seconds = 10;
+    if (!arg.empty()) {
+        char* end;
+        seconds = std::strtol(arg.c_str(), &end, 10);
+        if (*end != '\0' || seconds <= 0 || seconds > 3600) {
+            co_await session.write("Usage: /watch [SECONDS]");
+            co_return;
+        }
+    }
+    for (long i = 0; i < seconds; ++i) {
+        if (i > 0) co_await session.sleep(1000);
+        co_await session.write(server.stats());
+    }
+}
+
+/// Таблица команд; новая команда добавляется сюда и сразу доступна по TCP и UDP
+constexpr Command commands[] = {
+    {"time", cmdTime, Metrics::Counter::CmdTime, 1},
+    {"stats", cmdStats, Metrics::Counter::CmdStats, 2},
+    {"shutdown", cmdShutdown, Metrics::Counter::CmdShutdown, 3, coShutdown},
+    {"subscribe", cmdSubscribe, Metrics::Counter::CmdSubscribe, 4},
+    {"unsubscribe", cmdUnsubscribe, Metrics::Counter::CmdUnsubscribe, 5},
+    {"publish", cmdPublish, Metrics::Counter::CmdPublish, 6},
+    {"binary", cmdBinary, Metrics::Counter::CmdBinary, 0},
+    {"watch", cmdWatch, Metrics::Counter::CmdWatch, 0, coWatch},
+    {"shm", cmdShm, Metrics::Counter::CmdShm, 0},
+    {"trace", cmdTrace, Metrics::Counter::CmdTrace, 0},
+};
+constexpr size_t COMMAND_COUNT = sizeof(commands) / sizeof(commands[0]);
+
+/// Размер хэш-таблицы: степень двойки не меньше учетверенного количества команд
+/// (ячейку задают младшие биты хэша, на которые затравка влияет слабо: плотная таблица может не разместиться)
+constexpr size_t tableSize() {
+    size_t size = 4;
+    while (size < COMMAND_COUNT * 4) size <<= 1;
+    return size;
+}
+constexpr size_t TABLE_SIZE = tableSize();
+
+/// FNV-1a с затравкой
+constexpr uint32_t hashName(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char ch : name) {
+        h ^= static_cast<uint8_t>(ch);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/// Подбор затравки, при которой все имена команд попадают в разные ячейки
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0;; ++seed) {
+        bool used[TABLE_SIZE] = {};
+        bool ok = true;
+        for (const Command& c : commands) {
+            size_t slot = hashName(c.name, seed) & (TABLE_SIZE - 1);
+            if (used[slot]) {
+                ok = false;
+                break;
+            }
+            used[slot] = true;
+        }
+        if (ok) return seed;
+    }
+}
+constexpr uint32_t SEED = findSeed();
+
+/// Ячейка -> номер команды (-1 - пусто)
+constexpr std::array<int8_t, TABLE_SIZE> buildTable() {
+    std::array<int8_t, TABLE_SIZE> table{};
+    for (auto& slot : table) slot = -1;
+    for (size_t i = 0; i < COMMAND_COUNT; ++i)
+        table[hashName(commands[i].name, SEED) & (TABLE_SIZE - 1)] = static_cast<int8_t>(i);
+    return table;
+}
+constexpr std::array<int8_t, TABLE_SIZE> table = buildTable();
+
+/// Код операции -> номер команды (-1 - нет такой команды)
+constexpr std::array<int8_t, 256> buildOpcodes() {
+    std::array<int8_t, 256> opcodes{};
+    for (auto& slot : opcodes) slot = -1;
+    for (size_t i = 0; i < COMMAND_COUNT; ++i)
+        if (commands[i].opcode != 0) opcodes[commands[i].opcode] = static_cast<int8_t>(i);
+    return opcodes;
+}
+constexpr std::array<int8_t, 256> opcodes = buildOpcodes();
+
+} // namespace
+
+/**
+ * Выполнение команды
+ * @param server Сервер, над которым выполняется команда
+ * @param msg Сообщение, начинающееся с '/' (без '\n')
+ * @param reply Приемник ответа
+ */
+void CommandRegistry::dispatch(EpollServer& server, std::string_view msg, ReplySink& reply) {
+    // Имя команды - до первого пробела, аргумент - остаток после него
+    std::string_view body = msg.substr(1);
+    size_t space = body.find(' ');
+    std::string_view name = body.substr(0, space);
+    std::string_view arg = space == std::string_view::npos ? std::string_view() : body.substr(space + 1);
+
+    int8_t index = table[hashName(name, SEED) & (TABLE_SIZE - 1)];
+    if (index >= 0 && commands[index].name == name) {
+        const Command& c = commands[index];
+        Metrics::add(c.counter);
+        // Многошаговая команда продолжается сопрограммой соединения
+        Client* client = reply.client();
+        if (c.coHandler && client && client->protocol == Client::Protocol::Text) {
+            client->session.attach(server, *client);
+            client->session.adopt(c.coHandler(server, client->session, std::string(arg)));
+            return;
+        }
+        c.handler(server, arg, reply);
+        return;
+    }
+
+    Metrics::add(Metrics::Counter::CmdUnknown);
+    reply.fail("Unknown command");
+}
+
+/**
+ * Выполнение команды двоичного кадра
+ * @param server Сервер, над которым выполняется команда
+ * @param opcode Код операции кадра
+ * @param arg Нагрузка кадра - аргумент команды
+ * @param reply Приемник ответа
+ */
+void CommandRegistry::execute(EpollServer& server, uint8_t opcode, std::string_view arg, ReplySink& reply) {
+    int8_t index = opcodes[opcode];
+    if (index >= 0) {
+        const Command& c = commands[index];
+        Metrics::add(c.counter);
+        c.handler(server, arg, reply);
+        return;
+    }
+
+    Metrics::add(Metrics::Counter::CmdUnknown);
+    reply.fail("Unknown command");
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <netinet/in.h>
+
+class EpollServer;
+struct Client;
+
+/**
+ * Приемник ответа команды и ее отправитель
+ * Для TCP ответ ставится в очередь соединения с завершающим '\n',
+ * для UDP записывается в буфер датаграммы как есть.
+ * Отправитель нужен командам, которые запоминают его (подписки на каналы)
+ */
+class ReplySink {
+public:
+    explicit ReplySink(Client& client, uint8_t opcode = 0);
+    ReplySink(std::string& datagram, const sockaddr_in& peer, int reactor) :
+        datagram_(&datagram), peer_(&peer), reactor_(reactor) {}
+
+    void write(std::string_view text);
+    void fail(std::string_view text);
+
+    Client* client() const { return client_; }
+    const sockaddr_in* peer() const { return peer_; }
+    int reactor() const { return reactor_; }
+
+private:
+    Client* client_ = nullptr;
+    uint8_t opcode_ = 0;                 ///< Код операции кадра ответа (двоичный протокол)
+    std::string* datagram_ = nullptr;
+    const sockaddr_in* peer_ = nullptr;
+    int reactor_ = -1;
+};
+
+/**
+ * Реестр команд, общий для TCP и UDP
+ * Команды объявлены одной таблицей в Commands.cpp; имя команды (токен до пробела)
+ * ищется по совершенной хэш-функции, подобранной при компиляции, - одно сравнение
+ * строк на сообщение независимо от количества команд.
+ * В двоичном протоколе команда выбирается кодом операции кадра без разбора имени
+ */
+class CommandRegistry {
+public:
+    static void dispatch(EpollServer& server, std::string_view msg, ReplySink& reply);
+    static void execute(EpollServer& server, uint8_t opcode, std::string_view arg, ReplySink& reply);
+};
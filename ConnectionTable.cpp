@@ -0,0 +1,106 @@
+#include "ConnectionTable.h"
+
+/**
+ * Конструктор таблицы: выделяется только массив указателей на блоки
+ */
+ConnectionTable::ConnectionTable() :
+    chunks_(std::make_unique<std::atomic<Slot*>[]>(CHUNKS)) {
+    for (size_t i = 0; i < CHUNKS; ++i) chunks_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ConnectionTable::~ConnectionTable() {
+    for (size_t i = 0; i < CHUNKS; ++i) delete[] chunks_[i].load(std::memory_order_relaxed);
+}
+
+/**
+ * Слот fd без выделения памяти
+ * @return nullptr, если fd вне таблицы или блок еще не выделен
+ */
+ConnectionTable::Slot* ConnectionTable::slot(int fd) const {
+    auto index = static_cast<size_t>(fd);
+    if (fd < 0 || index >= MAX_FDS) return nullptr;
+    Slot* chunk = chunks_[index >> CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk ? &chunk[index & (CHUNK_SIZE - 1)] : nullptr;
+}
+
+/**
+ * Слот fd с выделением блока при первом обращении
+ * Блок устанавливается через CAS: при гонке двух реакторов лишний блок удаляется
+ */
+ConnectionTable::Slot* ConnectionTable::slotForOpen(int fd) {
+    auto index = static_cast<size_t>(fd);
+    if (fd < 0 || index >= MAX_FDS) return nullptr;
+    std::atomic<Slot*>& ref = chunks_[index >> CHUNK_BITS];
+    Slot* chunk = ref.load(std::memory_order_acquire);
+    if (!chunk) {
+        auto* fresh = new Slot[CHUNK_SIZE];
+        if (ref.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+            chunk = fresh;
+        else
+            delete[] fresh;
+    }
+    return &chunk[index & (CHUNK_SIZE - 1)];
+}
+
+/**
+ * Занятие слота принятым соединением
+ * Поколение публикуется последним, после заполнения клиента
+ * @param fd Файловый дескриптор клиента
+ * @param addr Адрес клиента
+ * @param owner Реактор, принявший соединение
+ * @return Клиент или nullptr, если номер fd не помещается в таблицу
+ */
+Client* ConnectionTable::open(int fd, const sockaddr_in& addr, int owner) {
+    Slot* s = slotForOpen(fd);
+    if (!s) return nullptr;
+
+    uint32_t generation = s->generation.load(std::memory_order_relaxed) + 1;
+    s->client.fd = fd;
+    s->client.reactor = owner;
+    s->owner.store(owner, std::memory_order_relaxed);
+    s->client.addr = addr;
+    s->client.generation = generation;
+    s->generation.store(generation, std::memory_order_release);
+    live_.fetch_add(1, std::memory_order_relaxed);
+    return &s->client;
+}
+
+/**
+ * Освобождение слота
+ * Вызывается до close(fd): пока номер не закрыт, ядро не выдаст его новому соединению
+ * @param fd Файловый дескриптор клиента
+ * @return true, если соединение было открыто
+ */
+bool ConnectionTable::close(int fd) {
+    Slot* s = slot(fd);
+    if (!s) return false;
+    uint32_t generation = s->generation.load(std::memory_order_relaxed);
+    if (!(generation & 1)) return false;
+
+    s->generation.store(generation + 1, std::memory_order_release);
+    s->client.reset();      // Буферы освобождаются сразу, а не при следующем соединении
+    live_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Поиск соединения по идентификатору события
+ * @param fd Файловый дескриптор
+ * @param generation Поколение соединения на момент подписки на события
+ * @return Клиент или nullptr, если соединение закрыто или fd уже принадлежит другому
+ */
+Client* ConnectionTable::find(int fd, uint32_t generation) const {
+    Slot* s = slot(fd);
+    if (!s || s->generation.load(std::memory_order_acquire) != generation || !(generation & 1)) return nullptr;
+    return &s->client;
+}
+
+/**
+ * Поиск открытого соединения по fd без проверки поколения
+ * Для потока, который владеет соединением (например, при его закрытии)
+ */
+Client* ConnectionTable::find(int fd) const {
+    Slot* s = slot(fd);
+    if (!s || !(s->generation.load(std::memory_order_acquire) & 1)) return nullptr;
+    return &s->client;
+}
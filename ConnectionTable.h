@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <netinet/in.h>
+#include "Client.h"
+
+/**
+ * Таблица TCP соединений, индексированная номером fd
+ * Слоты выровнены по кэш-линии и выделяются блоками по мере роста номеров fd,
+ * блоки не освобождаются до уничтожения таблицы. У каждого слота есть счетчик поколений:
+ * нечетное значение - слот занят, открытие и закрытие увеличивают его на 1.
+ * Событие несет поколение соединения, поэтому событие закрытого соединения
+ * не попадет к новому соединению с тем же номером fd. Поиск не берет блокировок;
+ * слот одного fd изменяет только поток, обрабатывающий этот fd
+ */
+class ConnectionTable {
+public:
+    static constexpr size_t MAX_FDS = size_t{1} << 20;   ///< Предел номера fd
+
+    ConnectionTable();
+    ~ConnectionTable();
+
+    Client* open(int fd, const sockaddr_in& addr, int owner);
+    bool close(int fd);
+    Client* find(int fd, uint32_t generation) const;
+    Client* find(int fd) const;
+    size_t live() const { return live_.load(std::memory_order_relaxed); }
+
+    /**
+     * Обход открытых соединений реактора
+     * @param owner Номер реактора
+     * @param fn Вызывается для каждого соединения; может закрыть переданное соединение
+     */
+    template <typename Fn>
+    void forEach(int owner, Fn&& fn) {
+        for (size_t i = 0; i < CHUNKS; ++i) {
+            Slot* chunk = chunks_[i].load(std::memory_order_acquire);
+            if (!chunk) continue;
+            for (size_t j = 0; j < CHUNK_SIZE; ++j) {
+                Slot& s = chunk[j];
+                // Клиент читается только в своих слотах: поля чужих слотов меняют другие реакторы
+                if ((s.generation.load(std::memory_order_acquire) & 1) && s.owner.load(std::memory_order_relaxed) == owner)
+                    fn(s.client);
+            }
+        }
+    }
+
+    /// Идентификатор события epoll: поколение в старших 32 битах, fd - в младших
+    static uint64_t token(int fd, uint32_t generation) {
+        return uint64_t{generation} << 32 | static_cast<uint32_t>(fd);
+    }
+    static int tokenFd(uint64_t token) { return static_cast<int>(static_cast<uint32_t>(token)); }
+    static uint32_t tokenGeneration(uint64_t token) { return static_cast<uint32_t>(token >> 32); }
+
+private:
+    static constexpr size_t CHUNK_BITS = 10;
+    static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_BITS;   ///< Слотов в блоке
+    static constexpr size_t CHUNKS = MAX_FDS / CHUNK_SIZE;
+
+    /// Слот соединения
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> generation{0};
+        std::atomic<int> owner{-1};     ///< Копия client.reactor для обхода из других потоков
+        Client client{};
+    };
+
+    Slot* slot(int fd) const;
+    Slot* slotForOpen(int fd);
+
+    std::unique_ptr<std::atomic<Slot*>[]> chunks_;
+    std::atomic<size_t> live_{0};   ///< Открытые соединения
+};
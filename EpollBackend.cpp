@@ -0,0 +1,742 @@
+#include "EpollBackend.h"
+#include "EpollServer.h"
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Utils.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Отправка очереди ответов в сокет или, после /shm, в кольцо ответов
+OutputQueue::FlushResult flushOut(Client& c) {
+    return c.shm ? c.shm->flush(c.out) : c.out.flush(c.fd);
+}
+
+} // namespace
+
+/**
+ * Конструктор epoll backend'а
+ * @param server Сервер с общей логикой соединений и команд
+ * @param pool Пул потоков (пустой в режиме реакторов)
+ */
+EpollBackend::EpollBackend(EpollServer& server, ThreadPool& pool) :
+    server_(server),
+    pool_(pool) {}
+
+/**
+ * Цикл обработки событий реактора
+ * @param r Реактор с созданными сокетами
+ */
+void EpollBackend::run(Reactor& r) {
+    initEpoll(r);   // Настройка epoll
+
+    if (pool_.size() > 0) dispatchLoop(r);
+    else reactorLoop(r);
+
+    closeAll(r);    // Корректное завершение работы
+}
+
+/**
+ * Классический цикл: один epoll, события передаются в пул потоков
+ * @param r Единственный реактор сервера
+ */
+void EpollBackend::dispatchLoop(Reactor& r) {
+    constexpr int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+
+    bool drained = false;    // Работа передана новому процессу (--handoff)
+
+    // Главный цикл обработки событий
+    while (!server_.shuttingDown()) {
+        // Ожидаем события с таймаутом 1 секунда или шаг колеса таймеров
+        // (без ожидания, если UDP сокет не дочитан)
+        FlightRecorder::record(FlightRecorder::Event::WaitBegin);
+        int n = waitEvents(r, events, MAX_EVENTS);
+        FlightRecorder::record(FlightRecorder::Event::WaitEnd, -1, n > 0 ? static_cast<uint64_t>(n) : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;  // Игнорируем прерывания
+            Logger::log(Logger::Level::Error, "epoll_wait: %s", strerror(errno));
+            break;
+        }
+
+        Metrics::record(Metrics::Histogram::EventBatch, static_cast<uint64_t>(n));
+
+        // Обрабатываем все произошедшие события
+        for (int i = 0; i < n; ++i) {
+            uint64_t token = events[i].data.u64;
+            uint32_t ev = events[i].events;
+
+            // Почтовый ящик разбирает сам диспетчер: сообщения раздаются потокам их соединений
+            if (ConnectionTable::tokenFd(token) == r.mailFd) {
+                drainMail(r);
+                continue;
+            }
+
+            // Добавляем обработку события в пул потоков.
+            // Все события одного fd выполняются одним потоком и по порядку
+            auto task = [this, &r, token, ev]() {
+                handleEvent(r, token, ev);
+            };
+            static_assert(Task::fitsInline<decltype(task)>(), "event task must not allocate");
+            pool_.enqueueFor(static_cast<size_t>(ConnectionTable::tokenFd(token)), std::move(task));
+        }
+
+        // Пул прочитал свой бюджет UDP датаграмм - ставим дочитывание за событиями итерации
+        if (r.udpBacklog.exchange(false)) {
+            int fd = r.udpFd;
+            pool_.enqueueFor(static_cast<size_t>(fd), [this, &r, fd]() {
+                handleEvent(r, ConnectionTable::token(fd, 0), EPOLLIN);
+            });
+        }
+
+        // Соединения с истекшим таймаутом закрывает, а проснувшиеся сопрограммы возобновляет
+        // поток, к которому привязан их fd
+        server_.expireClients(r);
+        for (uint64_t token : r.woken) {
+            pool_.enqueueFor(static_cast<size_t>(ConnectionTable::tokenFd(token)), [this, &r, token]() {
+                wake(r, token);
+            });
+        }
+        for (uint64_t token : r.expired) {
+            pool_.enqueueFor(static_cast<size_t>(ConnectionTable::tokenFd(token)), [this, &r, token]() {
+                closeExpired(r, token);
+            });
+        }
+
+        if (!drained && server_.draining()) {
+            drain(r);
+            drained = true;
+        }
+    }
+}
+
+/**
+ * Цикл реактора: accept, чтение и ответ выполняются в потоке реактора
+ * без передачи событий между потоками
+ * @param r Реактор, которым владеет текущий поток
+ */
+void EpollBackend::reactorLoop(Reactor& r) {
+    constexpr int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    bool drained = false;
+
+    while (!server_.shuttingDown()) {
+        // Если UDP сокет не дочитан, только опрашиваем готовность остальных сокетов
+        FlightRecorder::record(FlightRecorder::Event::WaitBegin);
+        int n = waitEvents(r, events, MAX_EVENTS);
+        FlightRecorder::record(FlightRecorder::Event::WaitEnd, -1, n > 0 ? static_cast<uint64_t>(n) : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            Logger::log(Logger::Level::Error, "epoll_wait: %s", strerror(errno));
+            break;
+        }
+
+        if (n > 0) Metrics::record(Metrics::Histogram::EventBatch, static_cast<uint64_t>(n));
+        for (int i = 0; i < n; ++i)
+            handleEvent(r, events[i].data.u64, events[i].events);
+
+        // Дочитываем UDP после обработки TCP событий этой итерации.
+        // В edge-triggered режиме новое событие для уже принятых датаграмм не придет
+        if (r.udpBacklog.exchange(false))
+            handleEvent(r, ConnectionTable::token(r.udpFd, 0), EPOLLIN);
+
+        server_.expireClients(r);
+        for (uint64_t token : r.woken) wake(r, token);
+        for (uint64_t token : r.expired) closeExpired(r, token);
+
+        if (!drained && server_.draining()) {
+            drain(r);
+            drained = true;
+        }
+    }
+}
+
+/**
+ * Таймаут epoll_wait: шаг колеса, если заданы таймауты соединений, иначе 1 секунда
+ * для проверки флага завершения
+ */
+int EpollBackend::waitTimeout() const {
+    return server_.timeouts() ? static_cast<int>(TimerWheel::TICK_MS) : 1000;
+}
+
+/**
+ * Ожидание событий epoll
+ * В режиме низкой задержки сначала опрашиваем epoll без сна в течение бюджета опроса:
+ * после активности следующее событие забирается без пробуждения потока планировщиком,
+ * а в простое поток засыпает как обычно
+ * @param r Реактор
+ * @param events Буфер событий
+ * @param maxEvents Размер буфера
+ * @return Результат epoll_wait
+ */
+int EpollBackend::waitEvents(Reactor& r, epoll_event* events, int maxEvents) {
+    if (r.udpBacklog) return epoll_wait(r.epollFd, events, maxEvents, 0);
+
+    if (uint64_t spin = server_.spinNs()) {
+        uint64_t deadline = Metrics::nowNs() + spin;
+        do {
+            int n = epoll_wait(r.epollFd, events, maxEvents, 0);
+            if (n != 0 || server_.shuttingDown()) return n;
+            cpuRelax();
+        } while (Metrics::nowNs() < deadline);
+    }
+    return epoll_wait(r.epollFd, events, maxEvents, waitTimeout());
+}
+
+/**
+ * Возобновление сопрограммы соединения после sleep, если соединение еще открыто
+ * @param r Реактор, которому принадлежит соединение
+ * @param token Идентификатор соединения
+ */
+void EpollBackend::wake(Reactor& r, uint64_t token) {
+    Client* c = server_.connections().find(ConnectionTable::tokenFd(token), ConnectionTable::tokenGeneration(token));
+    if (!c) return;
+    if (!server_.resumeSession(*c, Session::Wait::Sleep)) {
+        if (flushClient(r, *c)) closeClient(r, c->fd);
+        return;
+    }
+    flushClient(r, *c);
+}
+
+/**
+ * Закрытие соединения по таймауту, если оно еще не закрыто и fd не переиспользован
+ * @param r Реактор, которому принадлежит соединение
+ * @param token Идентификатор соединения
+ */
+void EpollBackend::closeExpired(Reactor& r, uint64_t token) {
+    int fd = ConnectionTable::tokenFd(token);
+    if (server_.connections().find(fd, ConnectionTable::tokenGeneration(token))) closeClient(r, fd);
+}
+
+/**
+ * Разбор почтового ящика реактора: сообщения каналов для его соединений
+ * С пулом сообщение передается потоку, к которому привязан fd подписчика,
+ * вместе со ссылкой на общий блок
+ * @param r Реактор
+ */
+void EpollBackend::drainMail(Reactor& r) {
+    // eventfd сбрасывается до забора сообщений: издатель, положивший сообщение после забора, разбудит снова
+    uint64_t value;
+    while (read(r.mailFd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+    PubSub::take(r);
+
+    // Соединения от предыдущего процесса приходят тем же ящиком: регистрирует их поток реактора
+    std::vector<Adoption> adoptions;
+    {
+        std::lock_guard<std::mutex> lock(r.mailMutex);
+        adoptions.swap(r.adoptions);
+    }
+    for (Adoption& a : adoptions) adopt(r, a);
+
+    for (Delivery& d : r.delivering) {
+        if (pool_.size() == 0) {
+            deliver(r, d);
+            continue;
+        }
+        auto fd = static_cast<size_t>(ConnectionTable::tokenFd(d.token));
+        auto task = [this, &r, d = std::move(d)]() { deliver(r, d); };
+        static_assert(Task::fitsInline<decltype(task)>(), "delivery task must not allocate");
+        pool_.enqueueFor(fd, std::move(task));
+    }
+}
+
+/**
+ * Постановка сообщения канала в очередь подписчика и отправка
+ * @param r Реактор, которому принадлежит соединение
+ * @param d Сообщение
+ */
+void EpollBackend::deliver(Reactor& r, const Delivery& d) {
+    Client* c = server_.connections().find(ConnectionTable::tokenFd(d.token), ConnectionTable::tokenGeneration(d.token));
+    if (c && server_.deliver(*c, d)) flushClient(r, *c);
+}
+
+/**
+ * Инициализация epoll для мониторинга сокетов
+ * @param r Реактор, для которого создается epoll
+ */
+void EpollBackend::initEpoll(Reactor& r) {
+    // Создаем epoll instance
+    r.epollFd = epoll_create1(0);
+    if (r.epollFd < 0) {
+        perror("epoll_create1");
+        exit(1);
+    }
+
+    // Лямбда для добавления файлового дескриптора в epoll
+    auto add_fd = [&r](int fd) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;  // Чтение + edge-triggered режим
+        ev.data.u64 = ConnectionTable::token(fd, 0);
+        if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    };
+
+    r.udpBatch = std::make_unique<UdpBatch>();
+
+    // Добавляем TCP и UDP сокеты и почтовый ящик каналов в epoll
+    add_fd(r.listenFd);
+    add_fd(r.udpFd);
+    add_fd(r.mailFd);
+
+    // Unix сокет общий для всех реакторов: EPOLLEXCLUSIVE будит один из них, а не все
+    if (r.unixFd >= 0) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+        ev.data.u64 = ConnectionTable::token(r.unixFd, 0);
+        if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, r.unixFd, &ev) < 0) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Обработка epoll события
+ * @param r Реактор, получивший событие
+ * @param token Идентификатор события: fd и поколение соединения
+ * @param events Маска произошедших событий
+ */
+void EpollBackend::handleEvent(Reactor& r, uint64_t token, uint32_t events) {
+    int fd = ConnectionTable::tokenFd(token);
+    if (fd == r.listenFd || fd == r.unixFd) {
+        handleTcpAccept(r, fd); // Новое TCP или Unix соединение
+    } else if (fd == r.udpFd) {
+        // Пришли UDP датаграммы; остаток сверх бюджета дочитывается позже
+        if (handleUdpRead(r)) r.udpBacklog = true;
+    } else if (fd == r.mailFd) {
+        drainMail(r);           // Сообщения каналов для соединений реактора
+    } else {
+        // Соединение закрыто, или событие относится к прежнему владельцу номера fd
+        Client* c = server_.connections().find(fd, ConnectionTable::tokenGeneration(token));
+        if (!c) return;
+        if (c->shm) {
+            handleShm(r, *c, events);
+            return;
+        }
+
+        // Сначала дописываем отложенные ответы, затем читаем новые данные
+        if ((events & EPOLLOUT) && !handleTcpWrite(r, *c)) return;
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) handleTcpRead(r, *c);
+    }
+}
+
+/**
+ * Принятие новых TCP соединений
+ * @param r Реактор, владеющий слушающим сокетом
+ * @param listenFd Слушающий TCP сокет реактора или общий Unix сокет
+ */
+void EpollBackend::handleTcpAccept(Reactor& r, int listenFd) {
+    // EMFILE/ENFILE повторяются на каждом событии, пока лимит дескрипторов исчерпан
+    static Logger::RateLimit acceptErrorLog(10);
+
+    // Обрабатываем все ожидающие соединения (edge-triggered)
+    while (true) {
+        // У клиента Unix сокета адреса нет - отмечаем только семейство
+        sockaddr_in clientAddr{};
+        socklen_t len = sizeof(clientAddr);
+        bool local = listenFd == r.unixFd;
+        int clientFd = local ? accept(listenFd, nullptr, nullptr) : accept(listenFd, (sockaddr*)&clientAddr, &len);
+        if (local) clientAddr.sin_family = AF_UNIX;
+        if (clientFd < 0) {
+            // Больше нет ожидающих соединений
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            Logger::log(acceptErrorLog, Logger::Level::Error, "accept: %s", strerror(errno));
+            break;
+        }
+
+        // Устанавливаем неблокирующий режим для клиента
+        makeNonBlocking(clientFd);
+
+        // Сохраняем информацию о клиенте до подписки: первое событие может прийти
+        // в другой поток пула сразу после epoll_ctl
+        Client* c = server_.registerClient(r, clientFd, clientAddr);
+        if (!c) {
+            close(clientFd);
+            continue;
+        }
+
+        // Добавляем клиента в epoll для мониторинга
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = ConnectionTable::token(clientFd, c->generation);
+        if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, clientFd, &ev) < 0) {
+            Logger::log(Logger::Level::Error, "epoll_ctl ADD client: %s", strerror(errno));
+            server_.unregisterClient(r, clientFd);
+            close(clientFd);
+        }
+    }
+}
+
+/**
+ * Чтение данных от TCP клиента
+ * Ответы на все сообщения, разобранные за один проход, уходят одним sendmsg
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ */
+void EpollBackend::handleTcpRead(Reactor& r, Client& c) {
+    int fd = c.fd;
+
+    // Клиент не забирает ответы: новые данные остаются в буфере сокета
+    if (c.readPaused) return;
+
+    // Читаем все доступные данные (edge-triggered) прямо во входной буфер клиента
+    uint64_t receivedAt = 0;
+    while (true) {
+        size_t room;
+        char* dst = c.buffer.prepare(EpollServer::recvHint(c), room);
+        ssize_t n = recv(fd, dst, room, 0);
+        if (n <= 0) {
+            // Закрываем соединение при ошибке или разрыве
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            closeClient(r, fd);
+            return;
+        }
+
+        // Фиксируем принятые данные и разбираем полные сообщения
+        if (receivedAt == 0) receivedAt = Metrics::nowNs();
+        Metrics::add(Metrics::Counter::TcpBytesIn, static_cast<uint64_t>(n));
+        c.buffer.commit(static_cast<size_t>(n));
+        if (!server_.processInput(c)) {
+            // Строка или кадр длиннее предела: отправляем ошибку и закрываем соединение
+            if (flushClient(r, c)) closeClient(r, fd);
+            return;
+        }
+
+        // Очередь ответов превысила порог: пробуем отправить, иначе перестаем читать
+        if (c.out.pending() > server_.outHighWater()) {
+            if (!flushClient(r, c)) return;
+            if (c.out.pending() > server_.outHighWater()) {
+                c.readPaused = true;
+                break;
+            }
+        }
+    }
+
+    // Задержка от приема первой порции до передачи ответов ядру
+    if (flushClient(r, c) && receivedAt != 0) {
+        Metrics::record(Metrics::Histogram::ReadToReply, Metrics::nowNs() - receivedAt);
+        server_.touchClient(c, receivedAt);
+    }
+}
+
+/**
+ * Дозапись отложенных ответов по событию EPOLLOUT
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ * @return false, если соединение было закрыто
+ */
+bool EpollBackend::handleTcpWrite(Reactor& r, Client& c) {
+    if (!flushClient(r, c)) return false;
+
+    // Очередь опустилась ниже половины порога - возобновляем чтение.
+    // В edge-triggered режиме новое EPOLLIN не придет для уже полученных данных,
+    // поэтому дочитываем сокет сразу
+    if (c.readPaused && c.out.pending() <= server_.outHighWater() / 2) {
+        c.readPaused = false;
+        handleTcpRead(r, c);
+        return false;   // Чтение уже выполнено (и могло закрыть соединение)
+    }
+    return true;
+}
+
+/**
+ * Обработка соединения, перешедшего на кольца в разделяемой памяти (/shm)
+ * Событие приходит от eventfd запросов (клиент записал запросы или освободил место
+ * под ответы) или от Unix сокета, закрытие которого завершает сеанс
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ * @param events Маска произошедших событий
+ */
+void EpollBackend::handleShm(Reactor& r, Client& c, uint32_t events) {
+    if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        closeClient(r, c.fd);
+        return;
+    }
+
+    // Сначала дописываем ответы, ждавшие места в кольце.
+    // eventfd не вычитываем: в edge-triggered режиме каждая запись клиента дает новое событие
+    if (!flushClient(r, c)) return;
+
+    uint64_t receivedAt = 0;
+    while (c.out.pending() <= server_.outHighWater()) {
+        ssize_t n = c.shm->receive(c.buffer, EpollServer::recvHint(c));
+        if (n < 0) {
+            closeClient(r, c.fd);
+            return;
+        }
+        if (n == 0) break;
+        if (receivedAt == 0) receivedAt = Metrics::nowNs();
+        Metrics::add(Metrics::Counter::TcpBytesIn, static_cast<uint64_t>(n));
+        if (!server_.processInput(c)) {
+            if (flushClient(r, c)) closeClient(r, c.fd);
+            return;
+        }
+        // Клиент не забирает ответы: запросы остаются в кольце до его пробуждения
+        if (c.out.pending() > server_.outHighWater() && !flushClient(r, c)) return;
+    }
+
+    if (flushClient(r, c) && receivedAt != 0) {
+        Metrics::record(Metrics::Histogram::ReadToReply, Metrics::nowNs() - receivedAt);
+        server_.touchClient(c, receivedAt);
+    }
+}
+
+/**
+ * Подписка на eventfd запросов сеанса /shm; Unix сокет остается в epoll только
+ * для обнаружения закрытия (EPOLLRDHUP)
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ * @return false, если подписаться не удалось
+ */
+bool EpollBackend::attachShm(Reactor& r, Client& c) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = ConnectionTable::token(c.fd, c.generation);
+    if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, c.shm->requestFd(), &ev) < 0) {
+        Logger::log(Logger::Level::Error, "epoll_ctl ADD shm: %s", strerror(errno));
+        return false;
+    }
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    epoll_ctl(r.epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.writeArmed = false;
+    return true;
+}
+
+/**
+ * Обработка входящих UDP датаграмм пачками recvmmsg/sendmmsg
+ * За одно событие читается не больше UDP_BATCHES_PER_EVENT пачек
+ * @param r Реактор, владеющий UDP сокетом
+ * @return true, если в сокете могли остаться непрочитанные датаграммы
+ */
+bool EpollBackend::handleUdpRead(Reactor& r) {
+    UdpBatch& batch = *r.udpBatch;
+
+    for (int round = 0; round < UDP_BATCHES_PER_EVENT; ++round) {
+        int n = batch.receive(r.udpFd);
+        if (n <= 0) {
+            server_.recordUdpBatch(0, batch.takeKernelDrops(), 0);
+            return false;
+        }
+
+        // Пул перегружен: вычитываем сокет, но не обрабатываем пачку
+        if (server_.overloaded()) {
+            Metrics::add(Metrics::Counter::UdpShed, static_cast<uint64_t>(n));
+            server_.recordUdpBatch(static_cast<size_t>(n), batch.takeKernelDrops(), 0);
+            if (static_cast<unsigned>(n) < UdpBatch::BATCH) return false;
+            continue;
+        }
+
+        // Разбираем всю пачку, ответы копятся в буферах пачки
+        uint64_t bytesIn = 0, bytesOut = 0;
+        for (unsigned i = 0; i < static_cast<unsigned>(n); ++i) {
+            bytesIn += batch.datagram(i).size();
+            if (server_.handleDatagram(r, batch.datagram(i), batch.peer(i), batch.reply(i))) {
+                bytesOut += batch.reply(i).size();
+                batch.queueReply(i);
+            }
+        }
+        Metrics::add(Metrics::Counter::UdpBytesIn, bytesIn);
+
+        // Все ответы пачки уходят одним sendmmsg
+        size_t txDropped = 0;
+        if (batch.queuedReplies() > 0) {
+            bool gso = server_.udpGso();
+            txDropped = batch.sendReplies(r.udpFd, gso);
+            if (!gso && server_.udpGso()) server_.disableUdpGso();
+            Metrics::add(Metrics::Counter::UdpBytesOut, bytesOut);
+        }
+        server_.recordUdpBatch(static_cast<size_t>(n), batch.takeKernelDrops(), txDropped);
+
+        // Неполная пачка - сокет вычитан до конца
+        if (static_cast<unsigned>(n) < UdpBatch::BATCH) return false;
+    }
+    return true;
+}
+
+/**
+ * Отправка очереди ответов клиента
+ * При заполненном буфере сокета подписываемся на EPOLLOUT, после опустошения - отписываемся.
+ * Сопрограмма, ждавшая опустошения очереди, возобновляется здесь и может дописать в нее еще
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ * @return false, если соединение было закрыто
+ */
+bool EpollBackend::flushClient(Reactor& r, Client& c) {
+    while (true) {
+        size_t before = c.out.pending();
+        auto result = flushOut(c);
+        size_t sent = before - c.out.pending();
+        Metrics::add(Metrics::Counter::TcpBytesOut, sent);
+        if (sent > 0 && server_.timeouts()) server_.touchClient(c, Metrics::nowNs());
+
+        switch (result) {
+            case OutputQueue::FlushResult::Drained:
+                if (c.writeArmed) updateInterest(r, c, false);
+                break;
+            case OutputQueue::FlushResult::Blocked:
+                // Место в кольце /shm освобождает клиент и будит через eventfd, EPOLLOUT не нужен
+                if (!c.writeArmed && !c.shm) updateInterest(r, c, true);
+                break;
+            case OutputQueue::FlushResult::Error:
+                closeClient(r, c.fd);
+                return false;
+        }
+
+        if (!server_.writerReady(c)) return true;
+        if (!server_.resumeSession(c, Session::Wait::Write)) {
+            flushOut(c);
+            closeClient(r, c.fd);
+            return false;
+        }
+    }
+}
+
+/**
+ * Изменение набора событий epoll для клиента
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ * @param wantWrite Подписаться ли на EPOLLOUT
+ */
+void EpollBackend::updateInterest(Reactor& r, Client& c, bool wantWrite) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET | (wantWrite ? EPOLLOUT : 0u);
+    ev.data.u64 = ConnectionTable::token(c.fd, c.generation);
+    if (epoll_ctl(r.epollFd, EPOLL_CTL_MOD, c.fd, &ev) == 0)
+        c.writeArmed = wantWrite;
+}
+
+/**
+ * Закрытие TCP соединения и удаление клиента из таблицы соединений
+ * Слот освобождается до close(fd), пока номер fd не может достаться новому соединению
+ * @param r Реактор, которому принадлежит соединение
+ * @param fd Файловый дескриптор клиента
+ */
+void EpollBackend::closeClient(Reactor& r, int fd) {
+    epoll_ctl(r.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    server_.unregisterClient(r, fd);
+    close(fd);
+}
+
+/**
+ * Уведомление клиента о завершении работы и закрытие соединения
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ */
+void EpollBackend::shutdownClient(Reactor& r, Client& c) {
+    // Последняя попытка отправить накопленное без ожидания EPOLLOUT
+    int fd = c.fd;
+    server_.notifyShutdown(c);
+    flushOut(c);
+    server_.unregisterClient(r, fd);
+    close(fd);
+}
+
+/**
+ * Обход соединений реактора в потоках, которые ими владеют
+ * С пулом каждое соединение обрабатывается потоком, к которому привязан его fd,
+ * после уже поставленных событий, чтобы не гоняться с их обработкой; возврат - после
+ * обработки всех соединений
+ * @param r Реактор
+ * @param fn Вызывается для каждого соединения; может закрыть его
+ */
+template <typename Fn>
+void EpollBackend::forEachOwned(Reactor& r, Fn fn) {
+    ConnectionTable& table = server_.connections();
+    if (pool_.size() == 0) {
+        table.forEach(r.id, fn);
+        return;
+    }
+
+    std::vector<uint64_t> tokens;
+    table.forEach(r.id, [&tokens](Client& c) { tokens.push_back(ConnectionTable::token(c.fd, c.generation)); });
+
+    std::atomic<size_t> remaining{tokens.size()};
+    for (uint64_t token : tokens) {
+        pool_.enqueueFor(static_cast<size_t>(ConnectionTable::tokenFd(token)), [&table, &remaining, &fn, token]() {
+            if (Client* c = table.find(ConnectionTable::tokenFd(token), ConnectionTable::tokenGeneration(token)))
+                fn(*c);
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    while (remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+}
+
+/**
+ * Уведомление клиентов реактора о завершении работы и закрытие соединений
+ * @param r Реактор
+ */
+void EpollBackend::closeAll(Reactor& r) {
+    forEachOwned(r, [this, &r](Client& c) { shutdownClient(r, c); });
+}
+
+/**
+ * Передача работы новому процессу (--handoff)
+ * Слушающий и UDP сокеты убираются из epoll - их копии уже у нового процесса, и ядро
+ * отдает соединения и датаграммы ему. Соединения реактора передаются тоже, если новый
+ * процесс их принимает; оставшиеся обслуживаются здесь до закрытия
+ * @param r Реактор
+ */
+void EpollBackend::drain(Reactor& r) {
+    epoll_ctl(r.epollFd, EPOLL_CTL_DEL, r.listenFd, nullptr);
+    epoll_ctl(r.epollFd, EPOLL_CTL_DEL, r.udpFd, nullptr);
+    if (r.unixFd >= 0) epoll_ctl(r.epollFd, EPOLL_CTL_DEL, r.unixFd, nullptr);
+    r.udpBacklog = false;
+
+    if (server_.handingOffClients())
+        forEachOwned(r, [this, &r](Client& c) { handOff(r, c); });
+    server_.reactorDrained();
+}
+
+/**
+ * Передача соединения новому процессу
+ * Соединение с неотправленными ответами, остановленным чтением, выполняющейся
+ * многошаговой командой или кольцами /shm остается у этого процесса: очередь ответов,
+ * кадр сопрограммы и разделяемая память не передаются. События, пришедшие после передачи, не найдут слот
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ */
+void EpollBackend::handOff(Reactor& r, Client& c) {
+    if (c.shm || !flushClient(r, c) || !c.out.empty() || c.readPaused || c.session.active()) return;
+    int fd = c.fd;
+    if (!server_.handOff(c)) return;
+    epoll_ctl(r.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    server_.unregisterClient(r, fd);
+    close(fd);
+}
+
+/**
+ * Регистрация соединения, полученного от предыдущего процесса
+ * Данные, пришедшие в сокет во время передачи, придут первым событием edge-triggered epoll
+ * @param r Реактор
+ * @param a Соединение и его состояние
+ */
+void EpollBackend::adopt(Reactor& r, Adoption& a) {
+    Client* c = server_.adoptClient(r, a);
+    if (!c) {
+        close(a.fd);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = ConnectionTable::token(a.fd, c->generation);
+    if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, a.fd, &ev) < 0) {
+        Logger::log(Logger::Level::Error, "epoll_ctl ADD client: %s", strerror(errno));
+        server_.unregisterClient(r, a.fd);
+        close(a.fd);
+    }
+}
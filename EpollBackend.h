@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include "IoBackend.h"
+#include "Reactor.h"
+#include "ThreadPool.h"
+
+class EpollServer;
+struct Client;
+struct epoll_event;
+
+/**
+ * Backend на epoll (edge-triggered)
+ * Без пула потоков события обрабатываются в потоке реактора,
+ * с пулом - передаются в него с привязкой к fd
+ */
+class EpollBackend : public IoBackend {
+public:
+    EpollBackend(EpollServer& server, ThreadPool& pool);
+
+    void run(Reactor& r) override;
+    bool attachShm(Reactor& r, Client& c) override;
+
+private:
+    void initEpoll(Reactor& r);
+    void dispatchLoop(Reactor& r);
+    void reactorLoop(Reactor& r);
+    void handleEvent(Reactor& r, uint64_t token, uint32_t events);
+    void handleTcpAccept(Reactor& r, int listenFd);
+    void handleTcpRead(Reactor& r, Client& c);
+    void handleShm(Reactor& r, Client& c, uint32_t events);
+    bool handleTcpWrite(Reactor& r, Client& c);
+    bool flushClient(Reactor& r, Client& c);
+    void updateInterest(Reactor& r, Client& c, bool wantWrite);
+    void closeClient(Reactor& r, int fd);
+    void shutdownClient(Reactor& r, Client& c);
+    bool handleUdpRead(Reactor& r);
+    void closeAll(Reactor& r);
+    void drain(Reactor& r);
+    void handOff(Reactor& r, Client& c);
+    void adopt(Reactor& r, Adoption& a);
+    template <typename Fn>
+    void forEachOwned(Reactor& r, Fn fn);
+    void closeExpired(Reactor& r, uint64_t token);
+    void wake(Reactor& r, uint64_t token);
+    void drainMail(Reactor& r);
+    void deliver(Reactor& r, const Delivery& d);
+    int waitTimeout() const;
+    int waitEvents(Reactor& r, epoll_event* events, int maxEvents);
+
+    /// Сколько пачек recvmmsg читается за одно событие, чтобы поток UDP не вытеснял TCP
+    static constexpr int UDP_BATCHES_PER_EVENT = 8;
+
+    EpollServer& server_;
+    ThreadPool& pool_;
+};
@@ -1,359 +1,883 @@
 #include "EpollServer.h"
+#include "Commands.h"
+#include "EpollBackend.h"
+#include "FlightRecorder.h"
+#include "Frame.h"
+#include "HeapCounter.h"
+#include "UringBackend.h"
 #include "Utils.h"
-#include <sys/epoll.h>
+#include "LineScanner.h"
+#include "Logger.h"
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <mutex>
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+namespace {
+
+/**
+ * Ядра потоков пула: первое ядро списка занимает поток реактора, остальные - пул
+ * (если ядро в списке одно, пул делит его с реактором)
+ */
+std::vector<int> poolCpus(const ServerConfig& config) {
+    if (config.cpuList.size() <= 1) return config.cpuList;
+    return std::vector<int>(config.cpuList.begin() + 1, config.cpuList.end());
+}
+
+} // namespace
 
 /**
  * Конструктор epoll сервера
- * @param port Порт для прослушивания
- * @param threads Количество потоков в пуле
- * @param token Токен для команды shutdown
+ * @param config Параметры запуска (порт, потоки, токен, реакторы, пороги очередей, backend, UDP)
  */
-EpollServer::EpollServer(int port, int threads, const std::string& token) :
-    port_(port),
-    shutdownToken_(token),
+EpollServer::EpollServer(const ServerConfig& config) :
+    port_(config.port),
+    shutdownToken_(config.shutdownToken),
     shutdownFlag_(false),
-    epollFd_(-1),
-    listenFd_(-1),
-    udpFd_(-1),
-    pool_(threads) {}
+    reactorCount_(config.reactors),
+    metricsPort_(config.metricsPort),
+    outHighWater_(config.outHighWater),
+    backendKind_(config.backend),
+    udpGso_(config.udpGso),
+    idleMs_(uint64_t{config.idleTimeout} * 1000),
+    lineMs_(uint64_t{config.lineTimeout} * 1000),
+    lifetimeMs_(uint64_t{config.maxLifetime} * 1000),
+    timeouts_(idleMs_ || lineMs_ || lifetimeMs_),
+    maxLine_(config.maxLine),
+    maxFrame_(config.maxFrame),
+    maxConnections_(config.maxConnections),
+    maxInflight_(config.maxInflight),
+    latencyMode_(config.latencyMode),
+    spinNs_(config.latencyMode ? uint64_t{config.spinUs} * 1000 : 0),
+    cpuList_(config.cpuList),
+    handoffPath_(config.handoffPath),
+    drainTimeout_(config.drainTimeout),
+    unixPath_(config.unixPath),
+    // Пул нужен только классическому epoll циклу; реакторы и io_uring обрабатывают события на месте
+    pool_(config.reactors > 0 || config.backend != ServerConfig::Backend::Epoll
+              ? 0 : static_cast<size_t>(config.threads),
+          spinNs_, poolCpus(config)),
+    udpPeers_(config.udpPeers, config.udpPeerTtl, config.udpPeerMax),
+    acceptLimiter_(config.acceptRate, config.acceptBurst, LIMITED_SOURCES),
+    udpLimiter_(config.udpRate, config.udpBurst, LIMITED_SOURCES),
+    pubsub_(reactors_, config.udpPeerTtl) {}
 
 /**
  * Деструктор - освобождает ресурсы сокетов
  */
 EpollServer::~EpollServer() {
-    if (listenFd_ != -1) close(listenFd_);
-    if (udpFd_ != -1) close(udpFd_);
-    if (epollFd_ != -1) close(epollFd_);
+    for (auto& r : reactors_) {
+        if (r->listenFd != -1) close(r->listenFd);
+        if (r->udpFd != -1) close(r->udpFd);
+        if (r->epollFd != -1) close(r->epollFd);
+        if (r->mailFd != -1) close(r->mailFd);
+    }
+    if (unixFd_ != -1) close(unixFd_);
+    // Файл сокета удаляет только тот, кто его создал, и только если сокет не передан новому процессу
+    if (unixBound_ && !draining()) unlink(unixPath_.c_str());
 }
 
 /**
  * Основной цикл работы сервера
  */
 void EpollServer::run() {
-    initSockets();  // Инициализация TCP и UDP сокетов
-    initEpoll();    // Настройка epoll
+    // Выбираем backend; если io_uring недоступен в ядре, работаем на epoll
+    if (backendKind_ == ServerConfig::Backend::Uring) {
+        if (UringBackend::supported()) {
+            backend_ = std::make_unique<UringBackend>(*this);
+        } else {
+            Logger::log(Logger::Level::Warn, "io_uring is not available, falling back to epoll");
+            backendKind_ = ServerConfig::Backend::Epoll;
+        }
+    }
+    if (!backend_) backend_ = std::make_unique<EpollBackend>(*this, pool_);
+
+    const bool reusePort = reactorCount_ > 0;
+    const int count = reusePort ? reactorCount_ : 1;
+
+    // Слушающие сокеты: от работающего процесса (--handoff), от systemd или свои
+    ListenSockets inherited;
+    std::string source;
+    bool takenOver = false;
+    if (!handoffPath_.empty()) {
+        handoff_ = std::make_unique<Handoff>(*this, handoffPath_, drainTimeout_);
+        takenOver = handoff_->takeover(adoptsClients(), inherited);
+        if (takenOver) source = " (sockets: handoff)";
+    }
+    if (source.empty() && Handoff::fromSystemd(inherited)) source = " (sockets: systemd)";
 
-    std::cout << "Server started on port: " << port_ << std::endl;
+    // Unix сокет один на процесс: его слушают все реакторы
+    if (unixPath_.empty()) {
+        if (inherited.unixFd >= 0) close(inherited.unixFd);
+    } else {
+        unixFd_ = inherited.unixFd >= 0 ? inherited.unixFd : bindUnix();
+        // Файл сокета, полученного от предыдущего процесса, удаляет тот, кто работает последним
+        if (inherited.unixFd >= 0 && takenOver) unixBound_ = true;
+        if (unixFd_ >= 0) makeNonBlocking(unixFd_);
+    }
 
-    constexpr int MAX_EVENTS = 64;
-    epoll_event events[MAX_EVENTS];
+    for (int i = 0; i < count; ++i) {
+        auto r = std::make_unique<Reactor>();
+        r->id = i;
+        r->unixFd = unixFd_;
+        auto index = static_cast<size_t>(i);
+        if (index < inherited.tcp.size()) r->listenFd = inherited.tcp[index];
+        if (index < inherited.udp.size()) r->udpFd = inherited.udp[index];
+        initSockets(*r, reusePort);  // Инициализация TCP и UDP сокетов
+        reactors_.push_back(std::move(r));
+    }
 
-    // Главный цикл обработки событий
-    while (!shutdownFlag_) {
-        // Ожидаем события с таймаутом 1 секунда
-        int n = epoll_wait(epollFd_, events, MAX_EVENTS, 1000);
-        if (n < 0) {
-            if (errno == EINTR) continue;  // Игнорируем прерывания
-            perror("epoll_wait");
-            break;
+    // Сокеты сверх числа реакторов закрываются: ядро перестанет отдавать им соединения
+    for (size_t i = static_cast<size_t>(count); i < inherited.tcp.size(); ++i) close(inherited.tcp[i]);
+    for (size_t i = static_cast<size_t>(count); i < inherited.udp.size(); ++i) close(inherited.udp[i]);
+
+    std::string mode;
+    if (reusePort) mode += " (reactors: " + std::to_string(count) + ")";
+    if (backendKind_ == ServerConfig::Backend::Uring) mode += " (io_uring)";
+    if (metricsPort_ > 0) mode += " (metrics: " + std::to_string(metricsPort_) + ")";
+    if (unixFd_ >= 0) mode += " (unix: " + unixPath_ + ")";
+    Logger::log(Logger::Level::Info, "Server started on port: %d%s%s", port_, mode.c_str(), source.c_str());
+
+    // Метрики для Prometheus отдаются отдельным потоком; после передачи работы их отдает новый процесс
+    if (metricsPort_ > 0) {
+        metrics_ = std::make_unique<MetricsServer>(
+            metricsPort_, [this] { return metricsText(); }, [this] { return shuttingDown() || draining(); });
+        metrics_->start(inherited.metrics);
+    } else if (inherited.metrics >= 0) {
+        close(inherited.metrics);
+    }
+    if (handoff_) handoff_->start();
+
+    if (reusePort) {
+        // Каждый реактор работает в своем потоке; ядро само распределяет
+        // входящие соединения и датаграммы между сокетами SO_REUSEPORT
+        for (auto& r : reactors_) {
+            Reactor* rp = r.get();
+            r->thread = std::thread([this, rp]() { runReactor(*rp, true); });
         }
+        for (auto& r : reactors_) r->thread.join();
+    } else {
+        runReactor(*reactors_.front(), false);
+    }
+    if (metrics_) metrics_->join();
+    if (handoff_) handoff_->join();
 
-        // Обрабатываем все произошедшие события
-        for (int i = 0; i < n; ++i) {
-            int fd = events[i].data.fd;
-            uint32_t ev = events[i].events;
+    Logger::log(Logger::Level::Info, "Server shutting down");
+}
 
-            // Добавляем обработку события в пул потоков
-            pool_.enqueue([this, fd, ev]() {
-                handleEvent(fd, ev);
-            });
-        }
+/**
+ * Запуск цикла событий реактора в текущем потоке
+ * @param r Реактор
+ * @param pinned Закрепить поток за ядром по номеру реактора (режим --reactors без --cpu-list)
+ */
+void EpollServer::runReactor(Reactor& r, bool pinned) {
+    // Закрепляем реактор за ядром, чтобы его соединения не мигрировали между кэшами:
+    // за ядром из --cpu-list или, в режиме --reactors, за ядром с номером реактора
+    unsigned cores = std::thread::hardware_concurrency();
+    if (!cpuList_.empty()) {
+        int cpu = cpuList_[static_cast<size_t>(r.id) % cpuList_.size()];
+        if (!pinThread(cpu)) Logger::log(Logger::Level::Warn, "Cannot pin reactor %d to CPU %d", r.id, cpu);
+    } else if (pinned && cores > 0) {
+        pinThread(static_cast<int>(static_cast<unsigned>(r.id) % cores));
     }
 
-    shutdown();  // Корректное завершение работы
+    backend_->run(r);
 }
 
 /**
  * Инициализация TCP и UDP сокетов
+ * Сокеты, полученные от предыдущего процесса или systemd, уже привязаны и слушают -
+ * им только выставляются параметры
+ * @param r Реактор, которому принадлежат сокеты
+ * @param reusePort Включить SO_REUSEPORT (несколько реакторов на одном порту)
+ */
+void EpollServer::initSockets(Reactor& r, bool reusePort) {
+    if (r.listenFd < 0) r.listenFd = bindSocket(SOCK_STREAM, reusePort);
+    if (r.udpFd < 0) r.udpFd = bindSocket(SOCK_DGRAM, reusePort);
+
+    int opt = 1;
+
+    // Ядро будет сообщать число датаграмм, отброшенных из-за переполнения буфера сокета
+    setsockopt(r.udpFd, SOL_SOCKET, SO_RXQ_OVFL, &opt, sizeof(opt));
+
+    // Режим низкой задержки: чтение опрашивает очередь сетевой карты вместо ожидания прерывания.
+    // Значение больше net.core.busy_read требует CAP_NET_ADMIN - тогда работаем без него
+    if (latencyMode_) {
+        int busyUs = static_cast<int>(spinNs_ / 1000);
+        for (int fd : {r.listenFd, r.udpFd}) {
+            if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busyUs, sizeof(busyUs)) < 0 ||
+                setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt)) < 0) {
+                static Logger::RateLimit busyPollLog(1);
+                Logger::log(busyPollLog, Logger::Level::Warn, "SO_BUSY_POLL: %s", strerror(errno));
+            }
+        }
+    }
+
+    // Устанавливаем неблокирующий режим
+    makeNonBlocking(r.listenFd);
+    makeNonBlocking(r.udpFd);
+
+    // Пробуждение реактора, когда издатели из других потоков кладут сообщения в его ящик
+    r.mailFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r.mailFd < 0) {
+        perror("eventfd");
+        exit(1);
+    }
+}
+
+/**
+ * Создание и привязка сокета к порту сервера
+ * @param type SOCK_STREAM (сокет начинает слушать) или SOCK_DGRAM
+ * @param reusePort Включить SO_REUSEPORT (каждый реактор получает свой сокет на том же порту)
+ * @return Файловый дескриптор сокета
  */
-void EpollServer::initSockets() {
-    // Создаем TCP и UDP сокеты
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    udpFd_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (listenFd_ < 0 || udpFd_ < 0) {
+int EpollServer::bindSocket(int type, bool reusePort) {
+    const bool tcp = type == SOCK_STREAM;
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) {
         perror("socket");
         exit(1);
     }
 
     // Разрешаем переиспользование порта
     int opt = 1;
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (tcp) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reusePort) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
 
     // Настраиваем адрес для привязки сокета
     sockaddr_in addr{};
     addr.sin_family = AF_INET;                    // Семейство адресов - IPv4
     addr.sin_addr.s_addr = INADDR_ANY;           // Принимаем подключения со всех сетевых интерфейсов
-    addr.sin_port = htons(port_);                // Порт: htons() преобразует число в сетевой порядок байт (big-endian)
-
-    // Привязываем сокеты к порту
-    if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("bind TCP");
-        exit(1);
-    }
+    addr.sin_port = htons(static_cast<uint16_t>(port_));               // Порт: htons() преобразует число в сетевой порядок байт (big-endian)
 
-    if (bind(udpFd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("bind UDP");
+    // Привязываем сокет к порту
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror(tcp ? "bind TCP" : "bind UDP");
         exit(1);
     }
 
-    // Устанавливаем неблокирующий режим
-    makeNonBlocking(listenFd_);
-    makeNonBlocking(udpFd_);
-
     // Начинаем прослушивать TCP соединения
-    if (listen(listenFd_, SOMAXCONN) < 0) {
+    if (tcp && listen(fd, SOMAXCONN) < 0) {
         perror("listen");
         exit(1);
     }
+    return fd;
 }
 
 /**
- * Инициализация epoll для мониторинга сокетов
+ * Создание Unix сокета для клиентов той же машины
+ * Файл, оставшийся от завершившегося процесса, пересоздается; к пути, на котором отвечает
+ * работающий процесс, не привязываемся. Ошибка не фатальна: сервер работает без Unix сокета
+ * @return Дескриптор слушающего сокета или -1
  */
-void EpollServer::initEpoll() {
-    // Создаем epoll instance
-    epollFd_ = epoll_create1(0);
-    if (epollFd_ < 0) {
-        perror("epoll_create1");
-        exit(1);
+int EpollServer::bindUnix() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (unixPath_.size() >= sizeof(addr.sun_path)) {
+        Logger::log(Logger::Level::Warn, "Unix socket path is too long: %s", unixPath_.c_str());
+        return -1;
     }
+    std::memcpy(addr.sun_path, unixPath_.c_str(), unixPath_.size() + 1);
 
-    // Лямбда для добавления файлового дескриптора в epoll
-    auto add_fd = [this](int fd) {
-        epoll_event ev{};
-        ev.events = EPOLLIN | EPOLLET;  // Чтение + edge-triggered режим
-        ev.data.fd = fd;
-        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
-            perror("epoll_ctl");
-            exit(1);
-        }
-    };
-
-    // Добавляем TCP и UDP сокеты в epoll
-    add_fd(listenFd_);
-    add_fd(udpFd_);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Logger::log(Logger::Level::Warn, "Unix socket: %s", strerror(errno));
+        return -1;
+    }
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+        Logger::log(Logger::Level::Warn, "Unix socket %s is in use by another process", unixPath_.c_str());
+        close(fd);
+        return -1;
+    }
+    if (errno == ECONNREFUSED) unlink(unixPath_.c_str());
+    close(fd);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        Logger::log(Logger::Level::Warn, "Unix socket %s: %s; serving TCP and UDP only", unixPath_.c_str(), strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    unixBound_ = true;
+    return fd;
 }
 
 /**
- * Обработка epoll события
- * @param fd Файловый дескриптор, на котором произошло событие
- * @param events Маска произошедших событий
+ * Регистрация принятого TCP соединения
+ * @param r Реактор, принявший соединение
+ * @param fd Файловый дескриптор клиента
+ * @param addr Адрес клиента
+ * @return Запись клиента в таблице соединений или nullptr, если соединение не допущено
+ *         (лимиты, перегрузка, номер fd вне таблицы) и backend должен закрыть сокет
  */
-void EpollServer::handleEvent(int fd, uint32_t events) {
-    if (fd == listenFd_) {
-        handleTcpAccept();  // Новое TCP соединение
-    } else if (fd == udpFd_) {
-        handleUdpRead();    // Пришла UDP датаграмма
-    } else {
-        handleTcpRead(fd);  // Данные от TCP клиента
+Client* EpollServer::registerClient(Reactor& r, int fd, const sockaddr_in& addr) {
+    // Контроль допуска: сначала дешевые глобальные проверки, затем лимит адреса
+    if (overloaded()) {
+        Metrics::add(Metrics::Counter::TcpShed);
+        return nullptr;
+    }
+    if ((maxConnections_ > 0 && connections_.live() >= maxConnections_) ||
+        (addr.sin_family == AF_INET && !acceptLimiter_.allow(addr.sin_addr.s_addr))) {
+        Metrics::add(Metrics::Counter::TcpRejected);
+        return nullptr;
+    }
+
+    // Сохраняем информацию о клиенте
+    Client* c = connections_.open(fd, addr, r.id);
+    if (!c) {
+        static Logger::RateLimit tableFullLog(10);
+        Logger::log(tableFullLog, Logger::Level::Error, "fd %d exceeds connection table size", fd);
+        return nullptr;
+    }
+    Metrics::add(Metrics::Counter::TcpAccepted);
+    FlightRecorder::record(FlightRecorder::Event::Accept, fd);
+    startTimer(r, *c);
+
+    // Логируем новое подключение (при шторме подключений - не чаще NEW_CLIENT_LOG_RATE в секунду)
+    static Logger::RateLimit newClientLog(NEW_CLIENT_LOG_RATE);
+    if (addr.sin_family == AF_UNIX) {
+        Metrics::add(Metrics::Counter::UnixAccepted);
+        Logger::log(newClientLog, Logger::Level::Info, "New Unix client");
+    } else if (Logger::enabled(Logger::Level::Info)) {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        Logger::log(newClientLog, Logger::Level::Info, "New TCP client %s:%u", ip, ntohs(addr.sin_port));
     }
+    return c;
 }
 
 /**
- * Принятие новых TCP соединений
+ * Регистрация соединения, полученного от предыдущего процесса
+ * Лимиты допуска не проверяются - соединение уже было принято. Недоразобранный вход
+ * разбирается заново: полных сообщений в нем нет, разбор восстанавливает ожидание кадра
+ * @param r Реактор, которому передано соединение
+ * @param a Соединение и его состояние
+ * @return Запись клиента или nullptr, если соединение не удалось зарегистрировать
+ *         и backend должен закрыть сокет
  */
-void EpollServer::handleTcpAccept() {
-    // Обрабатываем все ожидающие соединения (edge-triggered)
-    while (true) {
-        sockaddr_in clientAddr{};
-        socklen_t len = sizeof(clientAddr);
-        int clientFd = accept(listenFd_, (sockaddr*)&clientAddr, &len);
-        if (clientFd < 0) {
-            // Больше нет ожидающих соединений
-            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-            perror("accept");
-            break;
-        }
-
-        // Устанавливаем неблокирующий режим для клиента
-        makeNonBlocking(clientFd);
-
-        // Добавляем клиента в epoll для мониторинга
-        epoll_event ev{};
-        ev.events = EPOLLIN | EPOLLET;
-        ev.data.fd = clientFd;
-        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, clientFd, &ev) < 0) {
-            perror("epoll_ctl ADD client");
-            close(clientFd);
-            continue;
-        }
-
-        // Сохраняем информацию о клиенте
-        clients_[clientFd] = {clientFd, clientAddr, ""};
-        tcpTotal_++;
-        tcpCurrent_++;
+Client* EpollServer::adoptClient(Reactor& r, const Adoption& a) {
+    Client* c = connections_.open(a.fd, a.addr, r.id);
+    if (!c) return nullptr;
+    Metrics::add(Metrics::Counter::TcpAdopted);
+    startTimer(r, *c);
+
+    c->protocol = a.protocol;
+    if (!a.input.empty()) {
+        size_t room;
+        char* dst = c->buffer.prepare(a.input.size(), room);
+        std::memcpy(dst, a.input.data(), a.input.size());
+        c->buffer.commit(a.input.size());
+    }
+    if (!processInput(*c)) {
+        unregisterClient(r, a.fd);
+        return nullptr;
+    }
 
-        // Логируем новое подключение
-        std::lock_guard<std::mutex> lock(coutMutex_);
-        std::cout << "New TCP client " << inet_ntoa(clientAddr.sin_addr)
-                  << ":" << ntohs(clientAddr.sin_port) << std::endl;
+    // Подписки восстанавливаются последними: с этого момента соединению идут сообщения каналов
+    std::string_view channels = a.channels;
+    while (!channels.empty()) {
+        size_t space = channels.find(' ');
+        pubsub_.subscribe(channels.substr(0, space), *c);
+        channels = space == std::string_view::npos ? std::string_view() : channels.substr(space + 1);
     }
+    return c;
+}
+
+/**
+ * Постановка таймера соединения на ближайший из сроков; дальше он переставляется при срабатывании
+ * @param r Реактор, которому принадлежит соединение
+ * @param c Клиент
+ */
+void EpollServer::startTimer(Reactor& r, Client& c) {
+    if (!timeouts_) return;
+    uint64_t now = TimerWheel::monotonicMs();
+    c.acceptedAt = now;
+    c.lastActivity.store(now, std::memory_order_relaxed);
+    c.timer.data = ConnectionTable::token(c.fd, c.generation);
+    std::lock_guard<std::mutex> lock(r.timersMutex);
+    r.timers.schedule(c.timer, clientDeadline(c, now));
 }
 
 /**
- * Чтение данных от TCP клиента
+ * Удаление клиента из таблицы соединений
+ * Backend закрывает сокет после этого вызова, иначе номер fd может достаться
+ * новому соединению раньше, чем освободится слот
+ * @param r Реактор, которому принадлежит соединение
  * @param fd Файловый дескриптор клиента
  */
-void EpollServer::handleTcpRead(int fd) {
-    char buf[4096];
-
-    // Читаем все доступные данные (edge-triggered)
-    while (true) {
-        ssize_t n = recv(fd, buf, sizeof(buf), 0);
-        if (n <= 0) {
-            // Закрываем соединение при ошибке или разрыве
-            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
-                break;
-            epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
-            close(fd);
-            clients_.erase(fd);
-            tcpCurrent_--;
-            return;
+void EpollServer::unregisterClient(Reactor& r, int fd) {
+    if (Client* c = connections_.find(fd)) {
+        if (timeouts_ || c->session.active()) {
+            std::lock_guard<std::mutex> lock(r.timersMutex);
+            r.timers.cancel(c->timer);
+            r.timers.cancel(c->session.timer());
         }
-
-        // Добавляем данные в буфер клиента
-        clients_[fd].buffer.append(buf, n);
+        if (!c->channels.empty()) pubsub_.unsubscribeAll(*c);
     }
+    if (connections_.close(fd)) {
+        Metrics::add(Metrics::Counter::TcpClosed);
+        FlightRecorder::record(FlightRecorder::Event::Close, fd);
+    }
+}
+
+/**
+ * Разбор принятых данных клиента в его протоколе и постановка ответов в очередь
+ * @param c Клиент, чей буфер разбирается
+ * @return false, если сообщение превысило предел: в очередь поставлена ошибка,
+ *         и соединение нужно закрыть
+ */
+bool EpollServer::processInput(Client& c) {
+    FlightRecorder::record(FlightRecorder::Event::Parse, c.fd, c.buffer.size());
+    return c.protocol == Client::Protocol::Binary ? processFrames(c) : processLines(c);
+}
 
-    // Обрабатываем полные сообщения (до символа новой строки)
-    auto& data = clients_[fd].buffer;
-    size_t pos;
-    while ((pos = data.find('\n')) != std::string::npos) {
-        std::string msg = data.substr(0, pos);
-        data.erase(0, pos + 1);
+/**
+ * Разбор полных строк из буфера клиента и постановка ответов в очередь
+ * @param c Клиент, чей буфер разбирается
+ * @return false, если незавершенная строка превысила --max-line: в очередь поставлено
+ *         сообщение об ошибке, и соединение нужно закрыть
+ */
+bool EpollServer::processLines(Client& c) {
+    // Обрабатываем полные сообщения (до символа новой строки).
+    // Сообщения - срезы входного буфера, буфер сдвигается один раз в конце
+    std::string_view data = c.buffer.data();
+    size_t start = 0;
+    while (const char* nl = findNewline(data.data() + start, data.size() - start)) {
+        size_t pos = static_cast<size_t>(nl - data.data());
+        std::string_view msg = data.substr(start, pos - start);
+        std::string_view line = data.substr(start, pos - start + 1);   // Сообщение вместе с '\n'
+
+        // Пока выполняется многошаговая команда, строки принадлежат ее сопрограмме;
+        // занятая записью или sleep сопрограмма оставляет их в буфере до возобновления
+        if (c.session.active()) {
+            if (c.session.waiting() != Session::Wait::Line) break;
+            start = pos + 1;
+            c.session.resume(msg);
+            if (c.session.done()) c.session.reset();
+            continue;
+        }
+        start = pos + 1;
 
         if (msg.empty()) continue;
 
-        // Обработка команд, начинающихся с '/'
+        // Команды, начинающиеся с '/', выполняются через общий с UDP реестр
         if (msg[0] == '/') {
-            // Команда /time - возвращает текущее время
-            if (msg.rfind("/time", 0) == 0) {
-                sendToClient(fd, currentTime() + "\n");
-            }
-            // Команда /stats - возвращает статистику
-            else if (msg.rfind("/stats", 0) == 0) {
-                sendToClient(fd, stats() + "\n");
-            }
-            // Команда /shutdown - завершает работу сервера
-            else if (msg.rfind("/shutdown", 0) == 0) {
-                std::string providedToken;
-
-                // Извлекаем переданный токен
-                if (msg.size() > 10) {
-                    providedToken = msg.substr(10);
-                    if (!providedToken.empty() && providedToken[0] == ' ')
-                        providedToken.erase(0, 1);
-                }
-
-                // Если токен не установлен, разрешаем shutdown без проверки
-                if (shutdownToken_.empty()) {
-                    sendToClient(fd, "Server shutting down\n");
-                    shutdownFlag_ = true;
-                }
-                // Проверяем корректность токена
-                else if (providedToken != shutdownToken_) {
-                    sendToClient(fd, "Invalid token\n");
-                }
-                else {
-                    sendToClient(fd, "Server shutting down\n");
-                    shutdownFlag_ = true;
-                }
+            ReplySink sink(c);
+            CommandRegistry::dispatch(*this, msg, sink);
+
+            // /binary: остаток буфера - уже кадры
+            if (c.protocol == Client::Protocol::Binary) {
+                c.buffer.consume(start);
+                return processFrames(c);
             }
-            // Неизвестная команда
-            else {
-                sendToClient(fd, "Unknown command\n");
+            // /shm: запросы идут через кольцо, данные в сокете после команды не разбираются
+            if (c.shm) {
+                c.buffer.consume(data.size());
+                return true;
             }
         }
-        // Зеркалирование обычных сообщений
+        // Зеркалирование обычных сообщений: ответ ссылается на принятые байты
         else {
-            sendToClient(fd, msg + "\n");
+            Metrics::add(Metrics::Counter::CmdEcho);
+            c.out.pushRef(c.buffer.block(), line.data(), line.size());
+        }
+    }
+
+    c.buffer.consume(start);
+
+    // Остаток - незавершенная строка и полные строки, ждущие занятую сопрограмму:
+    // предел считается по всему остатку, иначе клиент, шлющий строки во время /watch,
+    // растил бы буфер без ограничений
+    if (maxLine_ > 0 && c.buffer.size() > maxLine_) {
+        Metrics::add(Metrics::Counter::TcpLineTooLong);
+        c.out.push("Line too long\n", 14);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Разбор полных кадров двоичного протокола
+ * Границы кадров известны из заголовков, байты нагрузки не просматриваются.
+ * Под незавершенный кадр буфер растет вместе с принятыми байтами: не больше чем
+ * вдвое (и не меньше FRAME_RESERVE_STEP) сверх них, а не сразу на длину из заголовка
+ * @param c Клиент в двоичном протоколе
+ * @return false, если кадр длиннее --max-frame: в очередь поставлен кадр ошибки,
+ *         и соединение нужно закрыть
+ */
+bool EpollServer::processFrames(Client& c) {
+    std::string_view data = c.buffer.data();
+    size_t start = 0;
+    size_t missing = 0;
+    while (data.size() - start >= Frame::HEADER) {
+        const char* header = data.data() + start;
+        uint32_t len = Frame::length(header);
+        if (len > maxFrame_) {
+            Metrics::add(Metrics::Counter::TcpLineTooLong);
+            c.buffer.consume(data.size());
+            ReplySink(c).fail("Frame too large");
+            return false;
+        }
+
+        size_t total = Frame::HEADER + len;
+        if (data.size() - start < total) {
+            missing = total - (data.size() - start);
+            break;
         }
+        uint8_t op = Frame::opcode(header);
+        start += total;
+
+        // Эхо: ответ - тот же кадр, ссылкой на принятые байты вместе с заголовком
+        if (op == Frame::ECHO) {
+            Metrics::add(Metrics::Counter::CmdEcho);
+            c.out.pushRef(c.buffer.block(), header, total);
+        } else {
+            ReplySink sink(c, op);
+            CommandRegistry::execute(*this, op, std::string_view(header + Frame::HEADER, len), sink);
+        }
+    }
+
+    c.buffer.consume(start);
+    c.frameMissing = missing;
+    if (missing > 0) {
+        // Заголовок пишет клиент: память выделяется по мере прихода нагрузки, удвоения сохраняют
+        // линейную стоимость копирования
+        size_t ahead = std::max(c.buffer.size(), FRAME_RESERVE_STEP);
+        c.buffer.reserve(c.buffer.size() + std::min(missing, ahead));
     }
+    return true;
 }
 
 /**
- * Обработка входящих UDP датаграмм
+ * Обработка UDP датаграммы
+ * @param r Реактор, принявший датаграмму
+ * @param msg Содержимое датаграммы
+ * @param peer Адрес отправителя
+ * @param reply [out] Ответ для отправки
+ * @return true, если ответ нужно отправить
  */
-void EpollServer::handleUdpRead() {
-    char buf[2048];
-    sockaddr_in peer{};
-    socklen_t len = sizeof(peer);
-
-    // Читаем датаграмму
-    ssize_t n = recvfrom(udpFd_, buf, sizeof(buf) - 1, 0, (sockaddr*)&peer, &len);
-    if (n <= 0) return;
-    buf[n] = '\0';
-
-    std::string msg(buf);
-    // Создаем уникальный ключ для UDP пира
-    std::string key = std::string(inet_ntoa(peer.sin_addr)) + ":" + std::to_string(ntohs(peer.sin_port));
-    udpPeers_.insert(key);
-
-    // Обрабатываем команды аналогично TCP
+bool EpollServer::handleDatagram(Reactor& r, std::string_view msg, const sockaddr_in& peer, std::string& reply) {
+    if (msg.empty()) return false;
+
+    // Датаграммы сверх лимита адреса отбрасываются без ответа
+    if (!udpLimiter_.allow(peer.sin_addr.s_addr)) {
+        Metrics::add(Metrics::Counter::UdpRejected);
+        return false;
+    }
+
+    // Учитываем пира (упакованный ключ адрес+порт, без строк и глобальной блокировки)
+    udpPeers_.touch(peer);
+
+    // Команды выполняются тем же реестром, что и для TCP
     if (msg[0] == '/') {
-        if (msg.rfind("/time", 0) == 0)
-            sendToUdpPeer(peer, currentTime());
-        else if (msg.rfind("/stats", 0) == 0)
-            sendToUdpPeer(peer, stats());
-        else
-            sendToUdpPeer(peer, "Unknown command");
+        ReplySink sink(reply, peer, r.id);
+        CommandRegistry::dispatch(*this, msg, sink);
     } else {
-        sendToUdpPeer(peer, msg);  // Зеркалирование
+        Metrics::add(Metrics::Counter::CmdEcho);
+        reply.assign(msg.data(), msg.size());  // Зеркалирование
     }
+    return true;
 }
 
 /**
- * Отправка сообщения TCP клиенту
- * @param fd Файловый дескриптор клиента
- * @param msg Сообщение для отправки
+ * Постановка сообщения канала в очередь ответов подписчика без копирования
+ * Вызывается потоком, обрабатывающим соединение. Подписчик, не забирающий ответы,
+ * пропускает сообщения, пока его очередь выше порога --high-water
+ * @param c Клиент-подписчик
+ * @param d Сообщение из почтового ящика реактора
+ * @return true, если сообщение поставлено в очередь и ее нужно отправить
  */
-void EpollServer::sendToClient(int fd, const std::string& msg) {
-    send(fd, msg.c_str(), msg.size(), 0);
+bool EpollServer::deliver(Client& c, const Delivery& d) {
+    if (c.out.pending() > outHighWater_) {
+        Metrics::add(Metrics::Counter::PubDropped);
+        return false;
+    }
+    if (c.protocol == Client::Protocol::Binary) {
+        // Кадр MESSAGE: заголовок копируется, нагрузка - тот же блок без '\n'
+        char header[Frame::HEADER];
+        Frame::writeHeader(header, Frame::MESSAGE, d.len - 1);
+        c.out.push(header, sizeof(header));
+        c.out.pushRef(d.block, d.block->data(), d.len - 1);
+    } else {
+        c.out.pushRef(d.block, d.block->data(), d.len);
+    }
+    Metrics::add(Metrics::Counter::PubDelivered);
+    return true;
 }
 
 /**
- * Отправка сообщения UDP пиру
- * @param peer Адрес получателя
+ * Постановка сообщения в очередь ответов TCP клиента
+ * Фактическая отправка выполняется backend'ом
+ * @param c Клиент-получатель
  * @param msg Сообщение для отправки
  */
-void EpollServer::sendToUdpPeer(const sockaddr_in& peer, const std::string& msg) {
-    sendto(udpFd_, msg.c_str(), msg.size(), 0, (sockaddr*)&peer, sizeof(peer));
+void EpollServer::sendToClient(Client& c, const std::string& msg) {
+    c.out.push(msg);
+}
+
+/**
+ * Уведомление клиента о завершении работы сервера
+ * @param c Клиент-получатель
+ */
+void EpollServer::notifyShutdown(Client& c) {
+    sendToClient(c, "Server shutting down\n");
+}
+
+/**
+ * Учет пачки принятых UDP датаграмм
+ * @param datagrams Размер пачки
+ * @param rxDropped Датаграммы, отброшенные ядром с прошлой пачки
+ * @param txDropped Ответы, которые не удалось отправить
+ */
+void EpollServer::recordUdpBatch(size_t datagrams, size_t rxDropped, size_t txDropped) {
+    if (datagrams > 0) {
+        Metrics::add(Metrics::Counter::UdpDatagrams, datagrams);
+        Metrics::add(Metrics::Counter::UdpBatches);
+        Metrics::record(Metrics::Histogram::UdpBatch, datagrams);
+        FlightRecorder::record(FlightRecorder::Event::UdpBatch, -1, datagrams);
+    }
+    if (rxDropped) Metrics::add(Metrics::Counter::UdpRxDropped, rxDropped);
+    if (txDropped) Metrics::add(Metrics::Counter::UdpTxDropped, txDropped);
+}
+
+/**
+ * Ближайший срок проверки соединения по таймаутам
+ * Начало новой строки не переставляет таймер (он только сдвигается при срабатывании),
+ * поэтому без незавершенной строки соединение проверяется не реже чем раз в lineMs_
+ * @param c Клиент
+ * @param now Текущее время, мс
+ * @return Время, мс; UINT64_MAX, если таймауты не заданы
+ */
+uint64_t EpollServer::clientDeadline(const Client& c, uint64_t now) const {
+    uint64_t deadline = UINT64_MAX;
+    if (idleMs_) deadline = std::min(deadline, c.lastActivity.load(std::memory_order_relaxed) + idleMs_);
+    if (lineMs_) {
+        uint64_t lineStartedAt = c.lineStartedAt.load(std::memory_order_relaxed);
+        deadline = std::min(deadline, (lineStartedAt ? lineStartedAt : now) + lineMs_);
+    }
+    if (lifetimeMs_) deadline = std::min(deadline, c.acceptedAt + lifetimeMs_);
+    return deadline;
+}
+
+/**
+ * Продвижение колеса таймеров реактора
+ * Сработавший таймер сверяется с актуальными отметками активности: если срок сдвинулся,
+ * таймер переставляется, иначе соединение попадает в r.expired. Таймеры sleep сопрограмм
+ * попадают в r.woken. Закрывает соединения и возобновляет сопрограммы backend, в потоке,
+ * который ими владеет
+ * @param r Реактор
+ */
+void EpollServer::expireClients(Reactor& r) {
+    r.expired.clear();
+    r.woken.clear();
+
+    uint64_t now = TimerWheel::monotonicMs();
+    std::lock_guard<std::mutex> lock(r.timersMutex);
+    r.timers.advance(now, [this, &r, now](TimerWheel::Node& node) {
+        Client* c = connections_.find(ConnectionTable::tokenFd(node.data), ConnectionTable::tokenGeneration(node.data));
+        if (!c) return;
+        // Таймер sleep сопрограммы: ее возобновляет поток соединения
+        if (&node == &c->session.timer()) {
+            r.woken.push_back(node.data);
+            return;
+        }
+        uint64_t deadline = clientDeadline(*c, now);
+        if (deadline > now) {
+            r.timers.schedule(node, deadline);
+            return;
+        }
+        r.expired.push_back(node.data);
+        Metrics::add(Metrics::Counter::TcpTimedOut);
+    });
+}
+
+/**
+ * Постановка таймера sleep сопрограммы соединения в колесо его реактора
+ * @param c Клиент, чья сопрограмма засыпает
+ * @param ms Длительность, мс
+ */
+void EpollServer::scheduleWake(Client& c, uint64_t ms) {
+    Reactor& r = *reactors_[static_cast<size_t>(c.reactor)];
+    TimerWheel::Node& node = c.session.timer();
+    node.data = ConnectionTable::token(c.fd, c.generation);
+    std::lock_guard<std::mutex> lock(r.timersMutex);
+    r.timers.schedule(node, TimerWheel::monotonicMs() + ms);
+}
+
+/**
+ * Возобновление сопрограммы соединения, дождавшейся события
+ * После ее завершения разбираются строки, накопившиеся во входном буфере
+ * @param c Клиент
+ * @param expected Событие, которое произошло
+ * @return false, если соединение нужно закрыть (см. processInput)
+ */
+bool EpollServer::resumeSession(Client& c, Session::Wait expected) {
+    if (c.session.waiting() != expected) return true;
+    c.session.resume();
+    if (!c.session.done()) return true;
+    c.session.reset();
+    return processInput(c);
+}
+
+/**
+ * Переход соединения Unix сокета на кольца в разделяемой памяти (/shm)
+ * Ответ уходит через сокет вместе с memfd колец и eventfd пробуждения, минуя очередь
+ * ответов; дальше запросы и ответы идут через кольца
+ * @param c Клиент Unix сокета с пустой очередью ответов
+ * @return false, если переход не удался (backend без поддержки, нет ресурсов, ошибка передачи)
+ */
+bool EpollServer::attachShm(Client& c) {
+    c.shm = ShmChannel::create();
+    if (!c.shm) return false;
+
+    static constexpr char REPLY[] = "Shared memory\n";
+    Reactor& r = *reactors_[static_cast<size_t>(c.reactor)];
+    if (!backend_->attachShm(r, c) || !c.shm->sendTo(c.fd, REPLY, sizeof(REPLY) - 1)) {
+        c.shm.reset();      // Закрытый eventfd сам пропадает из epoll
+        return false;
+    }
+    Metrics::add(Metrics::Counter::TcpBytesOut, sizeof(REPLY) - 1);
+    return true;
+}
+
+/**
+ * Слушающие сокеты для передачи новому процессу
+ * @return TCP и UDP сокеты реакторов по порядку и сокет /metrics
+ */
+ListenSockets EpollServer::listenSockets() const {
+    ListenSockets sockets;
+    for (const auto& r : reactors_) {
+        sockets.tcp.push_back(r->listenFd);
+        sockets.udp.push_back(r->udpFd);
+    }
+    if (metrics_) sockets.metrics = metrics_->fd();
+    sockets.unixFd = unixFd_;
+    return sockets;
+}
+
+/**
+ * Начало доработки после передачи слушающих сокетов
+ * Реакторы будятся через почтовые ящики и передают работу в своих потоках
+ * @param clients Передавать ли новому процессу открытые соединения
+ */
+void EpollServer::beginDrain(bool clients) {
+    handOffClients_ = clients;
+    drainPending_.store(reactors_.size(), std::memory_order_relaxed);
+    draining_.store(true, std::memory_order_release);
+    for (auto& r : reactors_) {
+        uint64_t one = 1;
+        while (write(r->mailFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    }
+}
+
+/**
+ * Передача соединения от предыдущего процесса в почтовый ящик реактора
+ * @param a Соединение и его состояние
+ * @param reactor Номер реактора в предыдущем процессе (берется по модулю числа реакторов)
+ */
+void EpollServer::adopt(Adoption a, int reactor) {
+    Reactor& r = *reactors_[static_cast<size_t>(reactor < 0 ? 0 : reactor) % reactors_.size()];
+    {
+        std::lock_guard<std::mutex> lock(r.mailMutex);
+        r.adoptions.push_back(std::move(a));
+    }
+    uint64_t one = 1;
+    while (write(r.mailFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
 }
 
 /**
- * Получение текущего времени
- * @return Строка с текущим временем
+ * Запрос завершения работы сервера
+ * @param token Переданный токен; если токен сервера не задан, проверка не выполняется
+ * @return true, если токен подошел и сервер завершает работу
  */
-std::string EpollServer::currentTime() const {
-    return nowString();
+bool EpollServer::requestShutdown(std::string_view token) {
+    if (!adminToken(token)) return false;
+    shutdownFlag_ = true;
+    return true;
 }
 
 /**
  * Получение статистики сервера
+ * Счетчики собираются со всех потоков в момент запроса
  * @return Строка со статистикой
  */
 std::string EpollServer::stats() const {
-    return "TCP total=" + std::to_string(tcpTotal_) +
-           " current=" + std::to_string(tcpCurrent_) +
-           " UDP unique=" + std::to_string(udpPeers_.size());
+    using C = Metrics::Counter;
+    using H = Metrics::Histogram;
+    Metrics::Snapshot m = Metrics::snapshot();
+    auto us = [](uint64_t ns) { return std::to_string(ns / 1000); };
+
+    return "TCP total=" + std::to_string(m[C::TcpAccepted]) +
+           " current=" + std::to_string(connections_.live()) +
+           " timed_out=" + std::to_string(m[C::TcpTimedOut]) +
+           " rejected=" + std::to_string(m[C::TcpRejected]) +
+           " shed=" + std::to_string(m[C::TcpShed]) +
+           " line_too_long=" + std::to_string(m[C::TcpLineTooLong]) +
+           " handed_off=" + std::to_string(m[C::TcpHandedOff]) +
+           " adopted=" + std::to_string(m[C::TcpAdopted]) +
+           " unix=" + std::to_string(m[C::UnixAccepted]) +
+           " bytes_in=" + std::to_string(m[C::TcpBytesIn]) +
+           " bytes_out=" + std::to_string(m[C::TcpBytesOut]) +
+           " UDP unique=" + std::to_string(udpPeers_.unique()) +
+           " untracked=" + std::to_string(udpPeers_.overflow()) +
+           " datagrams=" + std::to_string(m[C::UdpDatagrams]) +
+           " batches=" + std::to_string(m[C::UdpBatches]) +
+           " max_batch=" + std::to_string(m[H::UdpBatch].max) +
+           " rx_dropped=" + std::to_string(m[C::UdpRxDropped]) +
+           " tx_dropped=" + std::to_string(m[C::UdpTxDropped]) +
+           " udp_rejected=" + std::to_string(m[C::UdpRejected]) +
+           " udp_shed=" + std::to_string(m[C::UdpShed]) +
+           " rx_bytes=" + std::to_string(m[C::UdpBytesIn]) +
+           " tx_bytes=" + std::to_string(m[C::UdpBytesOut]) +
+           " CMD echo=" + std::to_string(m[C::CmdEcho]) +
+           " time=" + std::to_string(m[C::CmdTime]) +
+           " stats=" + std::to_string(m[C::CmdStats]) +
+           " shutdown=" + std::to_string(m[C::CmdShutdown]) +
+           " subscribe=" + std::to_string(m[C::CmdSubscribe]) +
+           " unsubscribe=" + std::to_string(m[C::CmdUnsubscribe]) +
+           " publish=" + std::to_string(m[C::CmdPublish]) +
+           " binary=" + std::to_string(m[C::CmdBinary]) +
+           " watch=" + std::to_string(m[C::CmdWatch]) +
+           " shm=" + std::to_string(m[C::CmdShm]) +
+           " trace=" + std::to_string(m[C::CmdTrace]) +
+           " unknown=" + std::to_string(m[C::CmdUnknown]) +
+           " PUBSUB published=" + std::to_string(m[C::PubPublished]) +
+           " delivered=" + std::to_string(m[C::PubDelivered]) +
+           " dropped=" + std::to_string(m[C::PubDropped]) +
+           " LATENCY reply_p50_us=" + us(m[H::ReadToReply].percentile(0.5)) +
+           " reply_p99_us=" + us(m[H::ReadToReply].percentile(0.99)) +
+           " reply_max_us=" + us(m[H::ReadToReply].max) +
+           " queue_p50_us=" + us(m[H::QueueWait].percentile(0.5)) +
+           " queue_p99_us=" + us(m[H::QueueWait].percentile(0.99)) +
+           " events_p50=" + std::to_string(m[H::EventBatch].percentile(0.5)) +
+           " events_max=" + std::to_string(m[H::EventBatch].max) +
+           " MEM allocs=" + std::to_string(m[C::MemAllocs]) +
+           " reused=" + std::to_string(m[C::MemReused]) +
+           " heap=" + std::to_string(HeapCounter::allocations()) +
+           " LOG dropped=" + std::to_string(Logger::dropped());
 }
 
 /**
- * Корректное завершение работы сервера
+ * Метрики в формате Prometheus для /metrics
+ * @return Счетчики и гистограммы Metrics плюс текущие значения сервера
  */
-void EpollServer::shutdown() {
-    std::lock_guard<std::mutex> lock(coutMutex_);
-    std::cout << "Server shutting down" << std::endl;
-    // Уведомляем всех клиентов о завершении работы
-    for (auto& [fd, c] : clients_) {
-        sendToClient(fd, "Server shutting down\n");
-        close(fd);
-    }
-    clients_.clear();
-}
\ No newline at end of file
+std::string EpollServer::metricsText() const {
+    return Metrics::prometheus() +
+           "# TYPE testing_task_tcp_connections gauge\ntesting_task_tcp_connections " +
+           std::to_string(connections_.live()) + "\n" +
+           "# TYPE testing_task_udp_unique_peers gauge\ntesting_task_udp_unique_peers " +
+           std::to_string(udpPeers_.unique()) + "\n" +
+           "# TYPE testing_task_log_dropped_total counter\ntesting_task_log_dropped_total " +
+           std::to_string(Logger::dropped()) + "\n" +
+           "# TYPE testing_task_heap_allocations_total counter\ntesting_task_heap_allocations_total " +
+           std::to_string(HeapCounter::allocations()) + "\n";
+}
@@ -1,46 +1,161 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <unordered_set>
 #include <atomic>
-#include <mutex>
+#include <memory>
+#include <vector>
 #include "Client.h"
+#include "ConnectionTable.h"
+#include "Handoff.h"
+#include "IoBackend.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "PubSub.h"
+#include "Reactor.h"
+#include "ServerConfig.h"
+#include "SourceLimiter.h"
 #include "ThreadPool.h"
+#include "UdpPeerTracker.h"
 
 class EpollServer {
 public:
-    EpollServer(int port, int threads, const std::string& token = "");
+    explicit EpollServer(const ServerConfig& config);
     ~EpollServer();
 
     void run();
 
-private:
-    void initSockets();
-    void initEpoll();
-    void handleEvent(int fd, uint32_t events);
-    void handleTcpAccept();
-    void handleTcpRead(int fd);
-    void handleUdpRead();
-    void sendToClient(int fd, const std::string& msg);
-    void sendToUdpPeer(const sockaddr_in& peer, const std::string& msg);
-    void shutdown();
-
-    std::string currentTime() const;
+    // Общая логика соединений и команд, которую вызывают backend'ы
+    Client* registerClient(Reactor& r, int fd, const sockaddr_in& addr);
+    Client* adoptClient(Reactor& r, const Adoption& a);
+    void unregisterClient(Reactor& r, int fd);
+    bool processInput(Client& c);
+    bool handleDatagram(Reactor& r, std::string_view msg, const sockaddr_in& peer, std::string& reply);
+    bool deliver(Client& c, const Delivery& d);
+    void notifyShutdown(Client& c);
+    void recordUdpBatch(size_t datagrams, size_t rxDropped, size_t txDropped);
+    void expireClients(Reactor& r);
+    void scheduleWake(Client& c, uint64_t ms);
+    bool resumeSession(Client& c, Session::Wait expected);
+
+    /// Сопрограмма соединения ждет опустошения очереди ответов, и очередь опустела до половины --high-water
+    bool writerReady(const Client& c) const {
+        return c.session.waiting() == Session::Wait::Write && c.out.pending() <= outHighWater_ / 2;
+    }
+
+    /**
+     * Отметка активности клиента для таймаутов: вызывается после приема или отправки данных
+     * потоком, обрабатывающим соединение. Колесо таймеров не трогается - срок пересчитывается,
+     * когда сработает ранее поставленный таймер
+     * @param c Клиент
+     * @param nowNs Текущее время Metrics::nowNs()
+     */
+    void touchClient(Client& c, uint64_t nowNs) {
+        if (!timeouts_) return;
+        uint64_t ms = nowNs / 1000000;
+        c.lastActivity.store(ms, std::memory_order_relaxed);
+        if (c.buffer.empty()) c.lineStartedAt.store(0, std::memory_order_relaxed);
+        else if (c.lineStartedAt.load(std::memory_order_relaxed) == 0) c.lineStartedAt.store(ms, std::memory_order_relaxed);
+    }
+
+    /**
+     * Минимум свободного места для следующего recv
+     * Под конец недополученного кадра буфер уже выделен - просим не больше остатка,
+     * чтобы prepare не переносил кадр в новый блок
+     * @param c Клиент
+     */
+    static size_t recvHint(const Client& c) {
+        return c.frameMissing > 0 && c.frameMissing < RECV_CHUNK ? c.frameMissing : RECV_CHUNK;
+    }
+    std::string metricsText() const;
+
+    // Операции, доступные командам реестра
     std::string stats() const;
+    bool requestShutdown(std::string_view token);
+    bool shutdownTokenSet() const { return !shutdownToken_.empty(); }
+    /// Токен служебных команд (/shutdown, /trace) верен или не задан
+    bool adminToken(std::string_view token) const { return shutdownToken_.empty() || token == shutdownToken_; }
+    PubSub& pubsub() { return pubsub_; }
+    bool attachShm(Client& c);
+
+    ConnectionTable& connections() { return connections_; }
+    bool shuttingDown() const { return shutdownFlag_; }
+    size_t outHighWater() const { return outHighWater_; }
+    bool udpGso() const { return udpGso_; }
+    bool timeouts() const { return timeouts_; }
+    /// Опрос перед засыпанием в режиме низкой задержки, нс (0 - режим выключен)
+    uint64_t spinNs() const { return spinNs_; }
+    /// Очереди пула превысили --max-inflight: новые соединения и датаграммы сбрасываются
+    bool overloaded() const { return maxInflight_ > 0 && pool_.queued() > maxInflight_; }
+    void disableUdpGso() { udpGso_ = false; }
+
+    // Передача работы новому процессу (--handoff)
+    ListenSockets listenSockets() const;
+    bool adoptsClients() const { return backendKind_ == ServerConfig::Backend::Epoll; }
+    void beginDrain(bool clients);
+    void adopt(Adoption a, int reactor);
+    bool handOff(const Client& c) { return handoff_ && handoff_->sendClient(c); }
+    /// Слушающие сокеты переданы: новые соединения и датаграммы принимает новый процесс
+    bool draining() const { return draining_.load(std::memory_order_relaxed); }
+    bool handingOffClients() const { return handOffClients_; }
+    void reactorDrained() { drainPending_.fetch_sub(1, std::memory_order_release); }
+    bool drainPending() const { return drainPending_.load(std::memory_order_acquire) > 0; }
+    void stop() { shutdownFlag_ = true; }
+
+private:
+    static constexpr uint32_t NEW_CLIENT_LOG_RATE = 100;   ///< Сообщений о новых клиентах в секунду
+    static constexpr size_t LIMITED_SOURCES = 1 << 18;      ///< Адресов в таблицах SourceLimiter
+    static constexpr size_t RECV_CHUNK = 4096;              ///< Обычный минимум места под recv
+    static constexpr size_t FRAME_RESERVE_STEP = 64 * InputBuffer::BLOCK_SIZE;   ///< Наименьший шаг роста буфера под кадр
+
+    void initSockets(Reactor& r, bool reusePort);
+    int bindSocket(int type, bool reusePort);
+    int bindUnix();
+    void startTimer(Reactor& r, Client& c);
+    void runReactor(Reactor& r, bool pinned);
+    bool processLines(Client& c);
+    bool processFrames(Client& c);
+    void sendToClient(Client& c, const std::string& msg);
+    uint64_t clientDeadline(const Client& c, uint64_t now) const;
 
     int port_;
     std::string shutdownToken_;
     std::atomic<bool> shutdownFlag_;
+    int reactorCount_;
+    int metricsPort_;
+    size_t outHighWater_;
+    ServerConfig::Backend backendKind_;
+    std::atomic<bool> udpGso_;
+    uint64_t idleMs_;           ///< Таймаут бездействия, мс (0 - нет)
+    uint64_t lineMs_;           ///< Таймаут незавершенной строки, мс (0 - нет)
+    uint64_t lifetimeMs_;       ///< Предел времени жизни соединения, мс (0 - нет)
+    bool timeouts_;             ///< Задан хотя бы один таймаут
+    size_t maxLine_;
+    size_t maxFrame_;
+    size_t maxConnections_;
+    size_t maxInflight_;
+    bool latencyMode_;
+    uint64_t spinNs_;
+    std::vector<int> cpuList_;
+    std::string handoffPath_;
+    uint32_t drainTimeout_;
+    std::atomic<bool> draining_{false};
+    std::atomic<bool> handOffClients_{false};
+    std::atomic<size_t> drainPending_{0};   ///< Реакторы, еще не передавшие работу
+    std::string unixPath_;                  ///< Unix сокет клиентов той же машины (пусто - выключен)
+    int unixFd_ = -1;
+    bool unixBound_ = false;                ///< Файл сокета удаляется при остановке (создан этим процессом или получен через --handoff)
 
-    int epollFd_;
-    int listenFd_;
-    int udpFd_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    ConnectionTable connections_;     ///< Соединения всех реакторов
 
     ThreadPool pool_;
-    std::unordered_map<int, Client> clients_;
-    std::unordered_set<std::string> udpPeers_;
+    std::unique_ptr<IoBackend> backend_;
+    std::unique_ptr<MetricsServer> metrics_;
+    UdpPeerTracker udpPeers_;
+    SourceLimiter acceptLimiter_;     ///< Новые TCP соединения с одного IP
+    SourceLimiter udpLimiter_;        ///< UDP датаграммы с одного IP
+    PubSub pubsub_;                   ///< Каналы /subscribe и /publish
+    std::unique_ptr<Handoff> handoff_;
 
-    size_t tcpTotal_ = 0;
-    size_t tcpCurrent_ = 0;
-    mutable std::mutex coutMutex_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,196 @@
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<FlightRecorder::Ring*> FlightRecorder::rings_{nullptr};
+std::atomic<bool> FlightRecorder::enabled_{false};
+
+namespace {
+/// Параметры дампа и поток, ожидающий SIGUSR1
+struct State {
+    uint32_t windowSec = 0;
+    std::string dir;
+    uint64_t baseTicks = 0;         ///< Точка отсчета для калибровки частоты TSC
+    uint64_t baseNs = 0;
+    std::mutex dumpMutex;           ///< Дампы по сигналу и по команде не пишутся одновременно
+    std::thread thread;
+    std::atomic<bool> stop{false};
+};
+State state;
+
+const char* const eventNames[] = {
+    "wait_begin", "wait_end", "enqueue", "dequeue", "task_done",
+    "parse", "send", "accept", "close", "udp_batch",
+};
+static_assert(sizeof(eventNames) / sizeof(eventNames[0]) == static_cast<size_t>(FlightRecorder::Event::Count),
+              "event name missing");
+
+sigset_t dumpSignals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    return set;
+}
+}
+
+uint64_t FlightRecorder::monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * Включение записи и потока дампа по SIGUSR1
+ * Вызывается до создания остальных потоков: SIGUSR1 блокируется в вызывающем потоке,
+ * все потоки наследуют маску, и сигнал принимает только поток дампа через sigwait
+ * @param windowSec Сколько последних секунд попадает в дамп (0 - самописец выключен)
+ * @param dir Каталог файлов дампа
+ */
+void FlightRecorder::start(uint32_t windowSec, const std::string& dir) {
+    if (windowSec == 0) return;
+    state.windowSec = windowSec;
+    state.dir = dir;
+    state.baseTicks = ticks();
+    state.baseNs = monotonicNs();
+
+    sigset_t set = dumpSignals();
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    state.stop = false;
+    enabled_ = true;
+    state.thread = std::thread(signalLoop);
+}
+
+/**
+ * Остановка потока дампа; кольца остаются до завершения процесса
+ */
+void FlightRecorder::stop() {
+    if (!state.thread.joinable()) return;
+    state.stop = true;
+    pthread_kill(state.thread.native_handle(), SIGUSR1);
+    state.thread.join();
+    enabled_ = false;
+}
+
+/**
+ * Цикл потока дампа: каждый SIGUSR1 - один файл
+ */
+void FlightRecorder::signalLoop() {
+    sigset_t set = dumpSignals();
+    while (true) {
+        int sig;
+        if (sigwait(&set, &sig) != 0 || state.stop) return;
+        std::string path;
+        size_t records;
+        if (dump(path, records))
+            Logger::log(Logger::Level::Info, "Trace written: %s (%zu records)", path.c_str(), records);
+    }
+}
+
+/**
+ * Сброс последних windowSec секунд всех колец в файл trace-PID-ВРЕМЯ.bin
+ * Писатели не останавливаются: кольцо копируется целиком, а записи, которые могли
+ * быть затерты во время копирования, отбрасываются по индексу head до и после
+ * @param path [out] Путь к файлу
+ * @param records [out] Записано событий
+ * @return false, если самописец выключен или файл не создан (ошибка записана в лог)
+ */
+bool FlightRecorder::dump(std::string& path, size_t& records) {
+    if (!enabled()) return false;
+    std::lock_guard<std::mutex> lock(state.dumpMutex);
+
+    FileHeader header;
+    header.dumpTsc = ticks();
+    uint64_t nowNs = monotonicNs();
+    if (nowNs > state.baseNs && header.dumpTsc > state.baseTicks)
+        header.ticksPerNs = static_cast<double>(header.dumpTsc - state.baseTicks) / static_cast<double>(nowNs - state.baseNs);
+    timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    header.dumpRealtimeNs = static_cast<uint64_t>(real.tv_sec) * 1000000000ull + static_cast<uint64_t>(real.tv_nsec);
+
+    double window = static_cast<double>(state.windowSec) * 1e9 * header.ticksPerNs;
+    uint64_t cutoff = static_cast<double>(header.dumpTsc) > window ? header.dumpTsc - static_cast<uint64_t>(window) : 0;
+
+    // Файл собирается в памяти и пишется одним вызовом
+    std::string out(sizeof(header), '\0');
+    std::vector<uint64_t> copy(RING_SIZE * 2);
+    records = 0;
+    for (Ring* r = rings_.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t before = r->head.load(std::memory_order_acquire);
+        for (size_t i = 0; i < copy.size(); ++i) copy[i] = r->words[i].load(std::memory_order_relaxed);
+        uint64_t after = r->head.load(std::memory_order_acquire);
+
+        // Во время копирования писатель мог затереть слоты записей до after + 1 - RING_SIZE
+        uint64_t first = after + 1 > RING_SIZE ? after + 1 - RING_SIZE : 0;
+        size_t at = out.size();
+        ThreadHeader th{r->tid, 0};
+        out.append(reinterpret_cast<const char*>(&th), sizeof(th));
+        for (uint64_t i = first; i < before; ++i) {
+            size_t slot = static_cast<size_t>(i & (RING_SIZE - 1)) * 2;
+            if (copy[slot] < cutoff) continue;
+            Record rec{copy[slot], static_cast<int32_t>(copy[slot + 1] >> 32), static_cast<uint32_t>(copy[slot + 1])};
+            out.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+            th.records++;
+        }
+        std::memcpy(&out[at], &th, sizeof(th));
+        records += th.records;
+        header.threads++;
+    }
+    std::memcpy(&out[0], &header, sizeof(header));
+
+    char stamp[32];
+    tm local;
+    localtime_r(&real.tv_sec, &local);
+    size_t len = std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    std::snprintf(stamp + len, sizeof(stamp) - len, "-%03ld", real.tv_nsec / 1000000);
+    path = state.dir + "/trace-" + std::to_string(getpid()) + "-" + stamp + ".bin";
+
+    static Logger::RateLimit errorLog(1);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::log(errorLog, Logger::Level::Error, "Trace %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = write(fd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    if (done < out.size()) {
+        Logger::log(errorLog, Logger::Level::Error, "Trace %s: short write", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+const char* FlightRecorder::name(Event event) {
+    size_t i = static_cast<size_t>(event);
+    return i < static_cast<size_t>(Event::Count) ? eventNames[i] : "unknown";
+}
+
+/**
+ * Регистрация кольца нового потока
+ * Кольца не освобождаются: дамп может читать их в любой момент
+ */
+FlightRecorder::Ring* FlightRecorder::registerRing() {
+    auto* r = new Ring();
+    r->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    Ring* head = rings_.load(std::memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!rings_.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+    return r;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Бортовой самописец: постоянно включенная трассировка событий обработки запросов
+ * Каждый поток пишет записи фиксированного размера (событие, fd, время TSC) в свое
+ * кольцо без блокировок и системных вызовов; старые записи затираются новыми.
+ * По SIGUSR1 или команде /trace последние секунды всех колец сбрасываются в файл,
+ * который tt_trace2chrome переводит в JSON для chrome://tracing и Perfetto
+ */
+class FlightRecorder {
+public:
+    /// Событие трассировки
+    enum class Event : uint8_t {
+        WaitBegin,      ///< Вход в epoll_wait / ожидание io_uring
+        WaitEnd,        ///< Возврат из ожидания (arg - событий)
+        Enqueue,        ///< Задача поставлена в пул (fd - ключ привязки или -1)
+        Dequeue,        ///< Задача взята потоком пула (arg - ожидание в очереди, мкс)
+        TaskDone,       ///< Задача пула выполнена
+        Parse,          ///< Разбор входного буфера соединения (arg - байт в буфере)
+        Send,           ///< Ответы переданы ядру (arg - байт)
+        Accept,         ///< Соединение зарегистрировано
+        Close,          ///< Соединение закрыто
+        UdpBatch,       ///< Пачка UDP датаграмм разобрана (arg - датаграмм)
+        Count
+    };
+
+    /// Запись в файле дампа
+    struct Record {
+        uint64_t tsc;
+        int32_t fd;
+        uint32_t eventArg;      ///< Событие в старших 8 битах, аргумент (с насыщением) - в младших 24
+    };
+
+    /// Заголовок файла дампа; за ним для каждого потока ThreadHeader и его записи по времени
+    struct FileHeader {
+        static constexpr uint32_t MAGIC = 0x52465454;     ///< "TTFR"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        uint32_t threads = 0;
+        uint32_t recordSize = sizeof(Record);
+        double ticksPerNs = 1.0;        ///< Частота TSC
+        uint64_t dumpTsc = 0;           ///< TSC в момент дампа
+        uint64_t dumpRealtimeNs = 0;    ///< Время CLOCK_REALTIME в момент дампа
+    };
+
+    struct ThreadHeader {
+        uint32_t tid;
+        uint32_t records;
+    };
+
+    static constexpr uint32_t ARG_MAX = (1u << 24) - 1;
+
+    static void start(uint32_t windowSec, const std::string& dir);
+    static void stop();
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * Запись события в кольцо текущего потока
+     * @param event Событие
+     * @param fd Дескриптор соединения или -1
+     * @param arg Аргумент события (больше ARG_MAX сохраняется как ARG_MAX)
+     */
+    static void record(Event event, int fd = -1, uint64_t arg = 0) {
+        if (!enabled()) return;
+        Ring& r = ring();
+        uint64_t head = r.head.load(std::memory_order_relaxed);
+        size_t slot = static_cast<size_t>(head & (RING_SIZE - 1)) * 2;
+        uint32_t packed = static_cast<uint32_t>(event) << 24 | static_cast<uint32_t>(arg < ARG_MAX ? arg : ARG_MAX);
+        r.words[slot].store(ticks(), std::memory_order_relaxed);
+        r.words[slot + 1].store(static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32 | packed,
+                                std::memory_order_relaxed);
+        r.head.store(head + 1, std::memory_order_release);
+    }
+
+    static bool dump(std::string& path, size_t& records);
+    static const char* name(Event event);
+
+    /// Счетчик тактов: TSC на x86, иначе монотонные наносекунды
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return monotonicNs();
+#endif
+    }
+
+    static uint64_t monotonicNs();
+
+private:
+    static constexpr size_t RING_SIZE = 65536;     ///< Записей в кольце потока (степень двойки, 1 МБ)
+
+    /// Кольцо одного потока: пишет поток-владелец, дамп читает копию без остановки писателя
+    struct Ring {
+        std::atomic<uint64_t> words[RING_SIZE * 2];     ///< Пары слов записи: TSC, fd и событие
+        alignas(64) std::atomic<uint64_t> head{0};      ///< Записей за все время
+        uint32_t tid = 0;
+        Ring* next = nullptr;
+    };
+
+    static Ring& ring() {
+        thread_local Ring* local = nullptr;
+        if (!local) local = registerRing();
+        return *local;
+    }
+
+    static Ring* registerRing();
+    static void signalLoop();
+
+    static std::atomic<Ring*> rings_;
+    static std::atomic<bool> enabled_;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <arpa/inet.h>
+
+/**
+ * Двоичный протокол TCP (включается командой /binary)
+ * Кадр: длина полезной нагрузки (4 байта, сетевой порядок), код операции (1 байт), нагрузка.
+ * Код 0 - эхо, коды команд заданы в таблице Commands.cpp; ответ приходит кадром
+ * с тем же кодом. Сообщения каналов приходят кадрами MESSAGE, ошибки - кадрами ERROR
+ */
+namespace Frame {
+
+constexpr size_t HEADER = 5;            ///< Размер заголовка кадра
+constexpr uint8_t ECHO = 0;             ///< Вернуть нагрузку как есть
+constexpr uint8_t MESSAGE = 0x80;       ///< Сообщение канала PubSub
+constexpr uint8_t ERROR = 0xFF;         ///< Текст ошибки (неизвестная команда, слишком длинный кадр)
+
+/// Длина нагрузки из заголовка
+inline uint32_t length(const char* header) {
+    uint32_t len;
+    std::memcpy(&len, header, sizeof(len));
+    return ntohl(len);
+}
+
+inline uint8_t opcode(const char* header) { return static_cast<uint8_t>(header[4]); }
+
+/// Запись заголовка в буфер из HEADER байт
+inline void writeHeader(char* out, uint8_t op, uint32_t len) {
+    uint32_t be = htonl(len);
+    std::memcpy(out, &be, sizeof(be));
+    out[4] = static_cast<char>(op);
+}
+
+} // namespace Frame
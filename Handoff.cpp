@@ -0,0 +1,465 @@
+#include "Handoff.h"
+#include "EpollServer.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "TimerWheel.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x54544832;       ///< "TTH2": версия формата передачи
+constexpr uint32_t WANT_CLIENTS = 1;         ///< Новый процесс принимает открытые соединения
+constexpr size_t MAX_FDS = 253;              ///< Предел дескрипторов в одном SCM_RIGHTS (SCM_MAX_FD)
+constexpr uint32_t MAX_STATE = 1u << 30;     ///< Предел состояния одного соединения, байт
+constexpr int SD_LISTEN_FDS_START = 3;       ///< Первый дескриптор, переданный systemd
+
+/// Запрос нового процесса
+struct Request {
+    uint32_t magic;
+    uint32_t flags;
+};
+
+/// Ответ старого процесса; дескрипторы: TCP и UDP сокеты реакторов по очереди, затем /metrics и Unix сокет
+struct SocketsHeader {
+    uint32_t magic;
+    uint32_t reactors;
+    uint32_t metrics;            ///< Передан ли сокет /metrics
+    uint32_t unixSocket;         ///< Передан ли Unix сокет
+    uint32_t clients;            ///< Следом будут переданы соединения
+};
+
+/// Соединение; дескриптор приходит вместе с записью, за ней - вход и каналы
+struct ClientRecord {
+    sockaddr_in addr;
+    int32_t reactor;
+    uint32_t protocol;
+    uint32_t inputLen;
+    uint32_t channelsLen;
+};
+
+/**
+ * Адрес Unix сокета
+ * @return false, если путь не помещается в sun_path
+ */
+bool unixAddress(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/**
+ * Отправка данных целиком; дескрипторы уходят с первой порцией
+ * @param fd Unix сокет
+ * @param iov Части сообщения (изменяются по мере отправки)
+ * @param iovCount Количество частей
+ * @param fds Передаваемые дескрипторы
+ * @param fdCount Количество дескрипторов
+ */
+bool sendAll(int fd, iovec* iov, size_t iovCount, const int* fds, size_t fdCount) {
+    std::vector<char> control(fdCount ? CMSG_SPACE(fdCount * sizeof(int)) : 0);
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovCount;
+    if (fdCount) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(fdCount * sizeof(int));
+        std::memcpy(CMSG_DATA(cm), fds, fdCount * sizeof(int));
+    }
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        msg.msg_control = nullptr;
+        msg.msg_controllen = 0;
+
+        auto sent = static_cast<size_t>(n);
+        while (msg.msg_iovlen > 0 && sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + sent;
+            msg.msg_iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+/**
+ * Прием ровно len байт
+ * @return false при разрыве, ошибке или таймауте
+ */
+bool readAll(int fd, void* buf, size_t len) {
+    auto* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * Прием записи фиксированного размера вместе с дескрипторами
+ * @param fds [out] Полученные дескрипторы (закрываются, если запись не принята целиком)
+ * @return false при разрыве, ошибке или таймауте
+ */
+bool receiveWithFds(int fd, void* buf, size_t len, std::vector<int>& fds) {
+    alignas(cmsghdr) char control[CMSG_SPACE(MAX_FDS * sizeof(int))];
+    iovec iov{buf, len};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    while ((n = recvmsg(fd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+
+    fds.clear();
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); n > 0 && cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; ++i) {
+            int received;
+            std::memcpy(&received, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            fds.push_back(received);
+        }
+    }
+    if (n == static_cast<ssize_t>(len) && !(msg.msg_flags & MSG_CTRUNC)) return true;
+
+    for (int received : fds) close(received);
+    fds.clear();
+    return false;
+}
+
+} // namespace
+
+/**
+ * Конструктор
+ * @param server Сервер, чьи сокеты и соединения передаются
+ * @param path Путь Unix сокета передачи
+ * @param drainTimeout Предел доработки оставшихся соединений после передачи, секунды
+ */
+Handoff::Handoff(EpollServer& server, std::string path, uint32_t drainTimeout) :
+    server_(server),
+    path_(std::move(path)),
+    drainMs_(uint64_t{drainTimeout} * 1000) {}
+
+Handoff::~Handoff() {
+    join();
+    if (listenFd_ != -1) close(listenFd_);
+    if (conn_ != -1) close(conn_);
+}
+
+/**
+ * Получение слушающих сокетов от работающего процесса
+ * Если старый процесс передает и соединения, связь остается открытой: они принимаются
+ * потоком передачи после запуска реакторов
+ * @param wantClients Backend может принять открытые соединения
+ * @param sockets [out] Полученные сокеты
+ * @return false, если по пути PATH никто не слушает (первый запуск) или передача не удалась
+ */
+bool Handoff::takeover(bool wantClients, ListenSockets& sockets) {
+    sockaddr_un addr;
+    if (!unixAddress(path_, addr)) {
+        Logger::log(Logger::Level::Error, "Handoff socket path is too long: %s", path_.c_str());
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // Зависший старый процесс не должен задерживать запуск нового
+    timeval timeout{10, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    Request req{MAGIC, wantClients ? WANT_CLIENTS : 0};
+    iovec iov{&req, sizeof(req)};
+    SocketsHeader header{};
+    std::vector<int> fds;
+    if (!sendAll(fd, &iov, 1, nullptr, 0) || !receiveWithFds(fd, &header, sizeof(header), fds)) {
+        Logger::log(Logger::Level::Error, "Handoff from %s failed: %s", path_.c_str(), strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    size_t expected = size_t{header.reactors} * 2 + (header.metrics ? 1 : 0) + (header.unixSocket ? 1 : 0);
+    if (header.magic != MAGIC || fds.size() != expected) {
+        Logger::log(Logger::Level::Error, "Handoff from %s: unexpected reply", path_.c_str());
+        for (int received : fds) close(received);
+        close(fd);
+        return false;
+    }
+
+    for (size_t i = 0; i < header.reactors; ++i) {
+        sockets.tcp.push_back(fds[2 * i]);
+        sockets.udp.push_back(fds[2 * i + 1]);
+    }
+    size_t next = size_t{header.reactors} * 2;
+    if (header.metrics) sockets.metrics = fds[next++];
+    if (header.unixSocket) sockets.unixFd = fds[next];
+
+    if (header.clients) conn_ = fd;
+    else close(fd);
+    Logger::log(Logger::Level::Info, "Took over %u listening socket pairs from the previous process", header.reactors);
+    return true;
+}
+
+/**
+ * Сокеты, переданные systemd (socket activation, LISTEN_FDS)
+ * Тип определяется по SO_TYPE и SO_DOMAIN; переменные окружения удаляются, чтобы их не унаследовали дочерние процессы
+ * @param sockets [out] Полученные сокеты
+ * @return true, если systemd передал хотя бы один сокет
+ */
+bool Handoff::fromSystemd(ListenSockets& sockets) {
+    const char* pid = getenv("LISTEN_PID");
+    const char* count = getenv("LISTEN_FDS");
+    if (!pid || !count || std::strtol(pid, nullptr, 10) != getpid()) return false;
+    long n = std::strtol(count, nullptr, 10);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+
+    for (int fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + n; ++fd) {
+        int type = 0, domain = 0;
+        socklen_t len = sizeof(type);
+        if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0) continue;
+        len = sizeof(domain);
+        getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if (domain == AF_UNIX && type == SOCK_STREAM && sockets.unixFd < 0) sockets.unixFd = fd;
+        else if (type == SOCK_STREAM) sockets.tcp.push_back(fd);
+        else if (type == SOCK_DGRAM) sockets.udp.push_back(fd);
+        else Logger::log(Logger::Level::Warn, "Ignoring socket %d of unsupported type from systemd", fd);
+    }
+    return !sockets.tcp.empty() || !sockets.udp.empty() || sockets.unixFd >= 0;
+}
+
+/**
+ * Открытие Unix сокета передачи и запуск потока
+ * Файл сокета пересоздается: он остался от завершенного процесса или принадлежит
+ * старому процессу, который уже передал работу
+ */
+void Handoff::start() {
+    sockaddr_un addr;
+    if (!unixAddress(path_, addr)) {
+        fprintf(stderr, "handoff: path is too long: %s\n", path_.c_str());
+        exit(1);
+    }
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        perror("socket handoff");
+        exit(1);
+    }
+    unlink(path_.c_str());
+    if (bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("bind handoff");
+        exit(1);
+    }
+    if (listen(listenFd_, 4) < 0) {
+        perror("listen handoff");
+        exit(1);
+    }
+
+    thread_ = std::thread([this] { loop(); });
+}
+
+/**
+ * Ожидание завершения потока (после установки флага завершения сервера)
+ */
+void Handoff::join() {
+    if (thread_.joinable()) thread_.join();
+}
+
+/**
+ * Цикл потока: прием соединений от предыдущего процесса, затем ожидание следующего обновления;
+ * раз в секунду проверяет флаг завершения
+ */
+void Handoff::loop() {
+    if (conn_ != -1) receiveClients();
+
+    while (!server_.shuttingDown()) {
+        pollfd p{listenFd_, POLLIN, 0};
+        if (poll(&p, 1, 1000) <= 0) continue;
+
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        if (serve(fd)) {
+            drain();
+            return;
+        }
+        close(fd);
+    }
+}
+
+/**
+ * Прием соединений от предыдущего процесса до закрытия им связи
+ * Соединения регистрируются потоками реакторов через их почтовые ящики
+ */
+void Handoff::receiveClients() {
+    size_t adopted = 0;
+    std::vector<int> fds;
+    ClientRecord rec{};
+    while (receiveWithFds(conn_, &rec, sizeof(rec), fds)) {
+        if (fds.size() != 1 || rec.protocol > static_cast<uint32_t>(Client::Protocol::Binary) ||
+            rec.inputLen > MAX_STATE || rec.channelsLen > MAX_STATE) {
+            for (int received : fds) close(received);
+            Logger::log(Logger::Level::Error, "Handoff: malformed connection record");
+            break;
+        }
+
+        Adoption a{fds[0], rec.addr, static_cast<Client::Protocol>(rec.protocol),
+                   std::string(rec.inputLen, '\0'), std::string(rec.channelsLen, '\0')};
+        if (!readAll(conn_, a.input.data(), a.input.size()) || !readAll(conn_, a.channels.data(), a.channels.size())) {
+            close(a.fd);
+            break;
+        }
+        server_.adopt(std::move(a), rec.reactor);
+        ++adopted;
+    }
+
+    close(conn_);
+    conn_ = -1;
+    Logger::log(Logger::Level::Info, "Adopted %zu connections from the previous process", adopted);
+}
+
+/**
+ * Передача слушающих сокетов новому процессу
+ * @param fd Соединение от нового процесса
+ * @return true, если сокеты переданы и этот процесс должен доработать и завершиться
+ */
+bool Handoff::serve(int fd) {
+    timeval timeout{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    Request req{};
+    if (!readAll(fd, &req, sizeof(req)) || req.magic != MAGIC) return false;
+
+    ListenSockets sockets = server_.listenSockets();
+    std::vector<int> fds;
+    for (size_t i = 0; i < sockets.tcp.size(); ++i) {
+        fds.push_back(sockets.tcp[i]);
+        fds.push_back(sockets.udp[i]);
+    }
+    if (sockets.metrics >= 0) fds.push_back(sockets.metrics);
+    if (sockets.unixFd >= 0) fds.push_back(sockets.unixFd);
+    if (fds.size() > MAX_FDS) {
+        Logger::log(Logger::Level::Error, "Handoff: too many sockets to pass (%zu)", fds.size());
+        return false;
+    }
+
+    bool clients = (req.flags & WANT_CLIENTS) && server_.adoptsClients();
+    SocketsHeader header{MAGIC, static_cast<uint32_t>(sockets.tcp.size()), sockets.metrics >= 0,
+                         sockets.unixFd >= 0, clients};
+    iovec iov{&header, sizeof(header)};
+    if (!sendAll(fd, &iov, 1, fds.data(), fds.size())) {
+        Logger::log(Logger::Level::Error, "Handoff: sending sockets failed: %s", strerror(errno));
+        return false;
+    }
+
+    if (clients) {
+        std::lock_guard<std::mutex> lock(connMutex_);
+        conn_ = fd;
+    } else {
+        close(fd);
+    }
+    Logger::log(Logger::Level::Info, "Listening sockets handed off to a new process, draining");
+    return true;
+}
+
+/**
+ * Доработка после передачи сокетов: реакторы передают соединения, связь закрывается
+ * (новый процесс перестает ждать соединений), затем ждем закрытия оставшихся соединений
+ * не дольше drainMs_ и завершаем сервер
+ */
+void Handoff::drain() {
+    close(listenFd_);
+    listenFd_ = -1;
+
+    bool clients;
+    {
+        std::lock_guard<std::mutex> lock(connMutex_);
+        clients = conn_ != -1;
+    }
+    server_.beginDrain(clients);
+    while (server_.drainPending() && !server_.shuttingDown())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    {
+        std::lock_guard<std::mutex> lock(connMutex_);
+        if (conn_ != -1) close(conn_);
+        conn_ = -1;
+    }
+
+    Logger::log(Logger::Level::Info, "Handed off %zu connections, %zu left to drain",
+                sent_.load(std::memory_order_relaxed), server_.connections().live());
+
+    uint64_t deadline = TimerWheel::monotonicMs() + drainMs_;
+    while (!server_.shuttingDown() && server_.connections().live() > 0 && TimerWheel::monotonicMs() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    server_.stop();
+}
+
+/**
+ * Передача соединения новому процессу
+ * Вызывается потоком, обрабатывающим соединение; очередь ответов должна быть пуста
+ * @param c Клиент
+ * @return false, если связь с новым процессом закрыта или оборвалась - соединение остается здесь
+ */
+bool Handoff::sendClient(const Client& c) {
+    std::string channels;
+    for (const std::string& channel : c.channels) {
+        if (!channels.empty()) channels += ' ';
+        channels += channel;
+    }
+    std::string_view input = c.buffer.data();
+
+    ClientRecord rec{c.addr, c.reactor, static_cast<uint32_t>(c.protocol),
+                     static_cast<uint32_t>(input.size()), static_cast<uint32_t>(channels.size())};
+    iovec iov[3] = {
+        {&rec, sizeof(rec)},
+        {const_cast<char*>(input.data()), input.size()},
+        {channels.data(), channels.size()},
+    };
+
+    std::lock_guard<std::mutex> lock(connMutex_);
+    if (conn_ == -1) return false;
+    if (!sendAll(conn_, iov, 3, &c.fd, 1)) {
+        // Поток байт мог оборваться посреди записи: остальные соединения остаются здесь
+        Logger::log(Logger::Level::Warn, "Handoff: sending connection failed: %s", strerror(errno));
+        close(conn_);
+        conn_ = -1;
+        return false;
+    }
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    Metrics::add(Metrics::Counter::TcpHandedOff);
+    return true;
+}
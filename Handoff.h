@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+
+class EpollServer;
+
+/**
+ * Слушающие сокеты, полученные от предыдущего процесса или от systemd
+ * Сокеты реактора N - tcp[N] и udp[N]
+ */
+struct ListenSockets
+{
+    std::vector<int> tcp;
+    std::vector<int> udp;
+    int metrics = -1;            ///< Сокет HTTP /metrics (только при передаче от процесса)
+    int unixFd = -1;             ///< Unix сокет клиентов той же машины
+};
+
+/**
+ * Обновление без простоя (--handoff PATH)
+ * Новый процесс подключается к Unix сокету PATH и получает через SCM_RIGHTS слушающие
+ * сокеты старого, а с epoll backend'ом - и открытые TCP соединения вместе с недоразобранным
+ * входом, протоколом и подписками. Старый процесс перестает принимать соединения и датаграммы,
+ * дорабатывает оставшиеся соединения (например, с неотправленными ответами) и завершается,
+ * когда они закроются или истечет --drain-timeout. После передачи новый процесс сам слушает
+ * PATH для следующего обновления
+ */
+class Handoff {
+public:
+    Handoff(EpollServer& server, std::string path, uint32_t drainTimeout);
+    ~Handoff();
+
+    bool takeover(bool wantClients, ListenSockets& sockets);
+    static bool fromSystemd(ListenSockets& sockets);
+
+    void start();
+    void join();
+    bool sendClient(const Client& c);
+
+private:
+    void loop();
+    void receiveClients();
+    bool serve(int fd);
+    void drain();
+
+    EpollServer& server_;
+    std::string path_;
+    uint64_t drainMs_;
+    int listenFd_ = -1;
+    std::mutex connMutex_;       ///< Защищает conn_: соединения передают потоки реакторов и пула
+    int conn_ = -1;              ///< Соединение с другим процессом на время передачи
+    std::atomic<size_t> sent_{0};
+    std::thread thread_;
+};
@@ -0,0 +1,42 @@
+#include "HeapCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+/// Обновляется только при обращении к куче, которого на горячем пути быть не должно
+std::atomic<uint64_t> heapAllocations{0};
+
+/**
+ * Выделение памяти с повтором через new_handler, как у стандартного operator new
+ * @param size Размер, байт
+ * @param alignment Выравнивание (0 - обычное)
+ */
+void* allocate(std::size_t size, std::size_t alignment) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    while (true) {
+        void* p = nullptr;
+        if (alignment == 0) p = std::malloc(size);
+        else if (posix_memalign(&p, alignment, size) != 0) p = nullptr;
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+}
+
+uint64_t HeapCounter::allocations() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+
+// Стандартные operator new[] и версии с nothrow вызывают эти две, а operator delete
+// по умолчанию освобождает память через free
+void* operator new(std::size_t size) {
+    return allocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Счетчик выделений памяти из кучи
+ * Глобальные operator new заменены версиями, которые считают каждый вызов: сюда попадают
+ * строки, контейнеры, кадры сопрограмм, задачи пула вне встроенного буфера и промахи
+ * BufferPool. В /stats это MEM heap; в установившемся режиме эхо счетчик не растет
+ */
+namespace HeapCounter {
+
+/// Выделений через operator new с запуска процесса
+uint64_t allocations();
+
+} // namespace HeapCounter
@@ -0,0 +1,73 @@
+#include "InputBuffer.h"
+#include <cstring>
+
+/**
+ * Подготовка свободного места для recv
+ * @param minFree Минимальный требуемый объем свободного места
+ * @param available [out] Фактический объем свободного места
+ * @return Указатель на свободную область в хвосте буфера
+ */
+char* InputBuffer::prepare(size_t minFree, size_t& available) {
+    if (!block_) {
+        block_ = BufferRef::allocate(BLOCK_SIZE > minFree ? BLOCK_SIZE : minFree);
+        head_ = tail_ = 0;
+    } else if (block_->capacity() - tail_ < minFree) {
+        size_t pending = tail_ - head_;
+        if (block_->unique() && pending + minFree <= block_->capacity()) {
+            // Блок только наш: сдвигаем недочитанный хвост в начало
+            std::memmove(block_->data(), block_->data() + head_, pending);
+        } else {
+            // Блок еще отправляется как эхо или слишком мал: переносим хвост в новый
+            size_t capacity = BLOCK_SIZE;
+            while (capacity < pending + minFree) capacity *= 2;
+            BufferRef fresh = BufferRef::allocate(capacity);
+            std::memcpy(fresh->data(), block_->data() + head_, pending);
+            block_ = std::move(fresh);
+        }
+        head_ = 0;
+        tail_ = pending;
+    }
+
+    available = block_->capacity() - tail_;
+    return block_->data() + tail_;
+}
+
+/**
+ * Подготовка буфера под следующую часть сообщения известной длины
+ * Блок выделяется ровно под total (не меньше BLOCK_SIZE), чтобы recv дописывал его
+ * без переносов; начало сообщения уже лежит в data()
+ * @param total Сколько байт, начиная с data(), должно поместиться в блок
+ */
+void InputBuffer::reserve(size_t total) {
+    if (block_ && block_->capacity() - head_ >= total) return;
+
+    size_t pending = tail_ - head_;
+    if (block_ && block_->unique() && total <= block_->capacity()) {
+        std::memmove(block_->data(), block_->data() + head_, pending);
+    } else {
+        BufferRef fresh = BufferRef::allocate(BLOCK_SIZE > total ? BLOCK_SIZE : total);
+        if (pending) std::memcpy(fresh->data(), block_->data() + head_, pending);
+        block_ = std::move(fresh);
+    }
+    head_ = 0;
+    tail_ = pending;
+}
+
+/**
+ * Отметка разобранных байт как прочитанных
+ * @param n Количество байт от начала data()
+ */
+void InputBuffer::consume(size_t n) {
+    head_ += n;
+    // Буфер пуст и не разделен с очередью ответов - начинаем блок заново без memmove
+    if (head_ == tail_ && block_ && block_->unique()) head_ = tail_ = 0;
+}
+
+/**
+ * Неразобранные данные
+ * @return Представление принятых, но еще не обработанных байт
+ */
+std::string_view InputBuffer::data() const {
+    if (!block_) return {};
+    return {block_->data() + head_, tail_ - head_};
+}
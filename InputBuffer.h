@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include "Buffer.h"
+
+/**
+ * Входной буфер TCP соединения
+ * recv пишет прямо в хвост блока, сообщения разбираются как string_view без копирования.
+ * Если блок разделен с очередью ответов (эхо ссылается на принятые байты),
+ * недочитанный остаток переносится в новый блок, а старый живет до отправки ответа
+ */
+class InputBuffer {
+public:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+    char* prepare(size_t minFree, size_t& available);
+    void reserve(size_t total);
+    void commit(size_t n) { tail_ += n; }
+    void consume(size_t n);
+
+    std::string_view data() const;
+    size_t size() const { return tail_ - head_; }
+    bool empty() const { return head_ == tail_; }
+    /// Блок, в котором лежат байты data(); нужен для ссылок из очереди ответов
+    const BufferRef& block() const { return block_; }
+
+private:
+    BufferRef block_;
+    size_t head_ = 0;       ///< Начало неразобранных данных
+    size_t tail_ = 0;       ///< Конец принятых данных
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include "Reactor.h"
+
+/**
+ * Интерфейс механизма ввода-вывода (epoll или io_uring)
+ * Backend отвечает только за доставку событий и отправку данных;
+ * разбор команд, таблица клиентов и статистика общие и живут в EpollServer
+ */
+class IoBackend {
+public:
+    virtual ~IoBackend() = default;
+
+    /**
+     * Цикл обработки событий реактора
+     * Возвращается после установки флага завершения, закрыв соединения реактора
+     * @param r Реактор с уже созданными TCP и UDP сокетами
+     */
+    virtual void run(Reactor& r) = 0;
+
+    /**
+     * Подписка на пробуждения сеанса /shm соединения
+     * @param r Реактор, которому принадлежит соединение
+     * @param c Клиент с уже созданным c.shm
+     * @return false, если backend не поддерживает кольца в разделяемой памяти
+     */
+    virtual bool attachShm(Reactor&, Client&) { return false; }
+};
@@ -0,0 +1,200 @@
+#include "IoUring.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+int sysSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int sysRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+template <typename T>
+T* at(void* base, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+/**
+ * Создание кольца и отображение его в память
+ * @param entries Размер очереди отправки (CQ в 4 раза больше)
+ * @return false, если io_uring недоступен (errno сохраняется)
+ */
+bool IoUring::init(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    ringFd_ = sysSetup(entries, &params);
+    if (ringFd_ < 0) return false;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        if (cqRingSize_ > sqRingSize_) sqRingSize_ = cqRingSize_;
+        cqRingSize_ = sqRingSize_;
+    }
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        return false;
+    }
+    if (singleMmap) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sqHead_ = at<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = at<unsigned>(sqRing_, params.sq_off.tail);
+    sqMask_ = *at<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqEntries_ = *at<unsigned>(sqRing_, params.sq_off.ring_entries);
+    sqeTail_ = submitted_ = *sqTail_;
+
+    // SQE используются строго по порядку, поэтому массив индексов заполняется один раз
+    unsigned* array = at<unsigned>(sqRing_, params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) array[i] = i;
+
+    cqHead_ = at<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = *at<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * Освобождение колец, буферов и дескриптора
+ */
+IoUring::~IoUring() {
+    if (bufRing_) munmap(bufRing_, bufRingSize_);
+    if (bufMemory_) munmap(bufMemory_, static_cast<size_t>(bufCount_) * bufSize_);
+    if (sqes_) munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+    if (sqRing_) munmap(sqRing_, sqRingSize_);
+    if (ringFd_ >= 0) close(ringFd_);
+}
+
+/**
+ * Получение свободного SQE
+ * Если очередь заполнена, накопленные SQE отправляются ядру без ожидания
+ * @return Обнуленный SQE или nullptr, если места нет даже после отправки
+ */
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqeTail_ - head >= sqEntries_) {
+        submitAndWait(0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqeTail_ - head >= sqEntries_) return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqeTail_;
+    return sqe;
+}
+
+/**
+ * Публикация заполненных SQE и ожидание завершений
+ * @param waitNr Минимальное количество CQE для ожидания (0 - не ждать)
+ * @return Результат io_uring_enter или -errno
+ */
+int IoUring::submitAndWait(unsigned waitNr) {
+    unsigned toSubmit = sqeTail_ - submitted_;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    submitted_ = sqeTail_;
+    if (toSubmit == 0 && waitNr == 0) return 0;
+
+    int ret = sysEnter(ringFd_, toSubmit, waitNr, waitNr > 0 ? IORING_ENTER_GETEVENTS : 0);
+    return ret < 0 ? -errno : ret;
+}
+
+/**
+ * Публикация SQE и сбор завершений без ожидания
+ * В отличие от submitAndWait(0) всегда входит в ядро: там выполняется отложенная работа
+ * кольца, которая публикует CQE сетевых операций
+ * @return Результат io_uring_enter или -errno
+ */
+int IoUring::submitAndPoll() {
+    unsigned toSubmit = sqeTail_ - submitted_;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    submitted_ = sqeTail_;
+    int ret = sysEnter(ringFd_, toSubmit, 0, IORING_ENTER_GETEVENTS);
+    return ret < 0 ? -errno : ret;
+}
+
+/**
+ * Регистрация кольца предоставленных буферов
+ * Ядро само выбирает буфер для каждого принятого сегмента multishot recv
+ * @param groupId Идентификатор группы буферов (buf_group в SQE)
+ * @param count Количество буферов (степень двойки)
+ * @param bufferSize Размер одного буфера
+ * @return false, если ядро не поддерживает IORING_REGISTER_PBUF_RING
+ */
+bool IoUring::registerBufferRing(uint16_t groupId, unsigned count, unsigned bufferSize) {
+    bufRingSize_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return false;
+    bufRing_ = static_cast<io_uring_buf_ring*>(ring);
+
+    bufCount_ = count;
+    bufSize_ = bufferSize;
+    void* memory = mmap(nullptr, static_cast<size_t>(count) * bufferSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    bufMemory_ = static_cast<char*>(memory);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+    reg.ring_entries = count;
+    reg.bgid = groupId;
+    if (sysRegister(ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+
+    for (unsigned i = 0; i < count; ++i) recycleBuffer(static_cast<uint16_t>(i));
+    return true;
+}
+
+/**
+ * Адрес буфера по его идентификатору из CQE
+ * @param bufferId Идентификатор буфера (cqe->flags >> IORING_CQE_BUFFER_SHIFT)
+ */
+char* IoUring::buffer(uint16_t bufferId) const {
+    return bufMemory_ + static_cast<size_t>(bufferId) * bufSize_;
+}
+
+/**
+ * Возврат буфера в кольцо после обработки данных
+ * @param bufferId Идентификатор буфера
+ */
+void IoUring::recycleBuffer(uint16_t bufferId) {
+    // Индексируем от начала кольца: в C++ __DECLARE_FLEX_ARRAY сдвигает поле bufs на 8 байт
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(bufRing_) + (bufTail_ & (bufCount_ - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bufferId));
+    buf->len = bufSize_;
+    buf->bid = bufferId;
+    ++bufTail_;
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+}
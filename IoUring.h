@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+/**
+ * Минимальная обертка над io_uring (без liburing)
+ * Кольца отображаются в память процесса, SQE заполняются вызывающим кодом,
+ * отправка и ожидание - одним системным вызовом io_uring_enter
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool init(unsigned entries);
+    int fd() const { return ringFd_; }
+
+    io_uring_sqe* getSqe();
+    int submitAndWait(unsigned waitNr);
+    int submitAndPoll();
+    bool hasCqe() const { return *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE); }
+
+    /**
+     * Обработка всех готовых CQE
+     * @param fn Вызывается для каждого CQE
+     * @return Количество обработанных CQE
+     */
+    template <typename Fn>
+    unsigned forEachCqe(Fn&& fn) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count) fn(cqes_[head & cqMask_]);
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Кольцо предоставленных буферов (provided buffer ring) для multishot recv
+    bool registerBufferRing(uint16_t groupId, unsigned count, unsigned bufferSize);
+    char* buffer(uint16_t bufferId) const;
+    unsigned bufferSize() const { return bufSize_; }
+    void recycleBuffer(uint16_t bufferId);
+
+private:
+    int ringFd_ = -1;
+
+    void* sqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    void* cqRing_ = nullptr;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned sqeTail_ = 0;       ///< Локальный хвост: SQE заполнены, но еще не опубликованы
+    unsigned submitted_ = 0;     ///< Хвост, уже опубликованный ядру
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    io_uring_buf_ring* bufRing_ = nullptr;
+    size_t bufRingSize_ = 0;
+    char* bufMemory_ = nullptr;
+    unsigned bufCount_ = 0;
+    unsigned bufSize_ = 0;
+    uint16_t bufTail_ = 0;
+};
@@ -0,0 +1,64 @@
+#include "LineScanner.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+namespace {
+
+/**
+ * Поиск '\n' блоками по 16 байт (SSE2 есть на любом x86-64)
+ */
+const char* findNewlineSse2(const char* data, size_t len) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+        if (mask != 0) return data + i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    for (; i < len; ++i)
+        if (data[i] == '\n') return data + i;
+    return nullptr;
+}
+
+/**
+ * Поиск '\n' блоками по 32 байта
+ */
+__attribute__((target("avx2")))
+const char* findNewlineAvx2(const char* data, size_t len) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+        if (mask != 0) return data + i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    // Хвост короче 32 байт дочитываем SSE2
+    return findNewlineSse2(data + i, len - i);
+}
+
+using ScanFn = const char* (*)(const char*, size_t);
+
+/**
+ * Выбор реализации по возможностям процессора (один раз при первом вызове)
+ */
+ScanFn selectScanner() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? findNewlineAvx2 : findNewlineSse2;
+}
+
+} // namespace
+
+const char* findNewline(const char* data, size_t len) {
+    static const ScanFn scan = selectScanner();
+    return scan(data, len);
+}
+
+#else
+
+const char* findNewline(const char* data, size_t len) {
+    return static_cast<const char*>(std::memchr(data, '\n', len));
+}
+
+#endif
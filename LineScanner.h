@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Поиск символа '\n' в буфере
+ * На x86-64 используется AVX2 (если поддерживается процессором) или SSE2,
+ * на остальных архитектурах - memchr
+ * @param data Начало области поиска
+ * @param len Длина области
+ * @return Указатель на найденный символ или nullptr
+ */
+const char* findNewline(const char* data, size_t len);
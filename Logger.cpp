@@ -0,0 +1,276 @@
+#include "Logger.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+std::atomic<Logger::Ring*> Logger::rings_{nullptr};
+std::atomic<Logger::Level> Logger::minLevel_{Logger::Level::Info};
+
+namespace {
+/// Состояние фонового потока записи
+struct Writer {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop = false;
+    std::atomic<bool> running{false};
+    int fd = STDOUT_FILENO;
+};
+Writer writer;
+
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(20);   ///< Период сбора колец
+
+const char* const levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+uint64_t realtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/// Запись буфера целиком (файл или stdout могут принять его частями)
+void writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        done += static_cast<size_t>(n);
+    }
+}
+}
+
+/**
+ * Запуск фонового потока записи
+ * @param minLevel Минимальный выводимый уровень
+ * @param dir Каталог для файла testing-task.log; пустая строка - stdout (journald)
+ */
+void Logger::start(Level minLevel, const std::string& dir) {
+    minLevel_ = minLevel;
+    if (!dir.empty()) {
+        std::string path = dir + "/testing-task.log";
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            perror(path.c_str());
+            exit(1);
+        }
+        writer.fd = fd;
+    }
+    writer.stop = false;
+    writer.running = true;
+    writer.thread = std::thread(writerLoop);
+}
+
+/**
+ * Остановка фонового потока с выводом всех накопленных записей
+ */
+void Logger::stop() {
+    if (!writer.running) return;
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.stop = true;
+    }
+    writer.cv.notify_one();
+    writer.thread.join();
+    writer.running = false;
+    if (writer.fd != STDOUT_FILENO) close(writer.fd);
+    writer.fd = STDOUT_FILENO;
+}
+
+/**
+ * Запись сообщения
+ * @param level Уровень важности
+ * @param fmt Формат printf
+ */
+void Logger::log(Level level, const char* fmt, ...) {
+    if (!enabled(level)) return;
+    va_list args;
+    va_start(args, fmt);
+    write(level, 0, fmt, args);
+    va_end(args);
+}
+
+/**
+ * Запись шумного сообщения с ограничением частоты
+ * @param limit Ограничитель места вызова
+ * @param level Уровень важности
+ * @param fmt Формат printf
+ */
+void Logger::log(RateLimit& limit, Level level, const char* fmt, ...) {
+    if (!enabled(level)) return;
+    uint64_t suppressed;
+    if (!limit.allow(suppressed)) return;
+    va_list args;
+    va_start(args, fmt);
+    write(level, suppressed, fmt, args);
+    va_end(args);
+}
+
+/**
+ * Форматирование записи прямо в кольцо текущего потока
+ * До запуска фонового потока (утилиты, ранняя инициализация) пишет в stderr синхронно
+ */
+void Logger::write(Level level, uint64_t suppressed, const char* fmt, va_list args) {
+    if (!writer.running.load(std::memory_order_acquire)) {
+        std::vfprintf(stderr, fmt, args);
+        std::fputc('\n', stderr);
+        return;
+    }
+
+    Ring& r = ring();
+    size_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        // Фоновый поток не успевает - теряем запись, но не ждем
+        r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& rec = r.records[head & (RING_SIZE - 1)];
+    rec.timeNs = realtimeNs();
+    rec.level = level;
+    int n = std::vsnprintf(rec.text, TEXT_SIZE, fmt, args);
+    size_t len = n < 0 ? 0 : static_cast<size_t>(n) < TEXT_SIZE ? static_cast<size_t>(n) : TEXT_SIZE - 1;
+    if (suppressed > 0 && len < TEXT_SIZE - 1) {
+        int m = std::snprintf(rec.text + len, TEXT_SIZE - len, " (%llu similar suppressed)",
+                              static_cast<unsigned long long>(suppressed));
+        if (m > 0) len = std::min(len + static_cast<size_t>(m), TEXT_SIZE - 1);
+    }
+    rec.length = static_cast<uint16_t>(len);
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * Кольцо текущего потока (создается при первой записи)
+ */
+Logger::Ring& Logger::ring() {
+    thread_local Ring* local = nullptr;
+    if (!local) local = registerRing();
+    return *local;
+}
+
+/**
+ * Регистрация кольца нового потока
+ * Кольца не освобождаются: фоновый поток может читать их в любой момент
+ */
+Logger::Ring* Logger::registerRing() {
+    auto* r = new Ring();
+    Ring* head = rings_.load(std::memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!rings_.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+    return r;
+}
+
+/**
+ * Сбор записей всех колец в текстовый буфер
+ * Записи упорядочены внутри потока; между потоками порядок - по кольцам
+ * @param out [out] Буфер для вывода
+ * @return Количество собранных записей
+ */
+size_t Logger::drain(std::string& out) {
+    size_t total = 0;
+    char prefix[64];
+    for (Ring* r = rings_.load(std::memory_order_acquire); r; r = r->next) {
+        size_t tail = r->tail.load(std::memory_order_relaxed);
+        size_t head = r->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail, ++total) {
+            const Record& rec = r->records[tail & (RING_SIZE - 1)];
+            time_t sec = static_cast<time_t>(rec.timeNs / 1000000000ull);
+            tm local;
+            localtime_r(&sec, &local);
+            size_t len = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+            std::snprintf(prefix + len, sizeof(prefix) - len, ".%03u %-5s ",
+                          static_cast<unsigned>(rec.timeNs / 1000000ull % 1000),
+                          levelNames[static_cast<size_t>(rec.level)]);
+            out += prefix;
+            out.append(rec.text, rec.length);
+            out += '\n';
+        }
+        r->tail.store(tail, std::memory_order_release);
+    }
+    return total;
+}
+
+/**
+ * Цикл фонового потока: раз в FLUSH_INTERVAL выводит все накопленное одним write
+ */
+void Logger::writerLoop() {
+    std::string out;
+    uint64_t reportedDrops = 0;
+    bool stopping = false;
+
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+            writer.cv.wait_for(lock, FLUSH_INTERVAL, [] { return writer.stop; });
+            stopping = writer.stop;
+        }
+
+        out.clear();
+        drain(out);
+
+        uint64_t drops = dropped();
+        if (drops != reportedDrops) {
+            out += "logger: " + std::to_string(drops - reportedDrops) + " messages dropped\n";
+            reportedDrops = drops;
+        }
+        if (!out.empty()) writeAll(writer.fd, out);
+    }
+}
+
+/**
+ * Общее количество записей, потерянных из-за заполненных колец
+ */
+uint64_t Logger::dropped() {
+    uint64_t total = 0;
+    for (Ring* r = rings_.load(std::memory_order_acquire); r; r = r->next)
+        total += r->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+/**
+ * Разбор имени уровня из командной строки
+ * @param name debug, info, warn или error
+ * @param level [out] Уровень
+ * @return false для неизвестного имени
+ */
+bool Logger::parseLevel(const std::string& name, Level& level) {
+    for (size_t i = 0; i < sizeof(levelNames) / sizeof(levelNames[0]); ++i) {
+        std::string lower = levelNames[i];
+        for (char& ch : lower) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        if (name == lower) {
+            level = static_cast<Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Проверка лимита частоты
+ * @param suppressed [out] Сколько сообщений подавлено с последнего пропущенного
+ * @return true, если сообщение нужно записать
+ */
+bool Logger::RateLimit::allow(uint64_t& suppressed) {
+    uint64_t now = realtimeNs() / 1000000000ull;
+    uint64_t window = window_.load(std::memory_order_relaxed);
+    if (now != window && window_.compare_exchange_strong(window, now, std::memory_order_relaxed))
+        count_.store(0, std::memory_order_relaxed);
+
+    if (count_.fetch_add(1, std::memory_order_relaxed) >= perSecond_) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+}
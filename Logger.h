@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Асинхронный логгер
+ * Каждый поток пишет записи в свое кольцо (один производитель, один потребитель)
+ * без блокировок и системных вызовов; фоновый поток собирает кольца и выводит
+ * их пачкой одним write в stdout (journald) или в файл. Если кольцо заполнено,
+ * запись отбрасывается и учитывается в счетчике потерь
+ */
+class Logger {
+public:
+    /// Уровень важности сообщения
+    enum class Level : uint8_t {
+        Debug,
+        Info,
+        Warn,
+        Error
+    };
+
+    /**
+     * Ограничение частоты шумного сообщения (одно на место вызова)
+     * Сверх limit сообщений в секунду записи подавляются, их количество
+     * добавляется к первому сообщению следующей секунды
+     */
+    class RateLimit {
+    public:
+        explicit RateLimit(uint32_t perSecond) : perSecond_(perSecond) {}
+        bool allow(uint64_t& suppressed);
+
+    private:
+        uint32_t perSecond_;
+        std::atomic<uint64_t> window_{0};       ///< Текущая секунда
+        std::atomic<uint32_t> count_{0};        ///< Сообщений в текущей секунде
+        std::atomic<uint64_t> suppressed_{0};   ///< Подавлено с последнего пропущенного сообщения
+    };
+
+    static void start(Level minLevel, const std::string& dir);
+    static void stop();
+
+    static bool enabled(Level level) { return level >= minLevel_.load(std::memory_order_relaxed); }
+    static void log(Level level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    static void log(RateLimit& limit, Level level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+    static uint64_t dropped();
+
+    static bool parseLevel(const std::string& name, Level& level);
+
+private:
+    static constexpr size_t RING_SIZE = 512;      ///< Записей в кольце потока (степень двойки)
+    static constexpr size_t TEXT_SIZE = 238;      ///< Максимальная длина текста записи
+
+    /// Запись лога фиксированного размера
+    struct Record {
+        uint64_t timeNs;
+        Level level;
+        uint8_t reserved;
+        uint16_t length;
+        char text[TEXT_SIZE];
+    };
+
+    /// Кольцо одного потока: пишет поток-владелец, читает фоновый поток
+    struct Ring {
+        Record records[RING_SIZE];
+        alignas(64) std::atomic<size_t> head{0};    ///< Следующая запись производителя
+        alignas(64) std::atomic<size_t> tail{0};    ///< Следующая запись потребителя
+        std::atomic<uint64_t> dropped{0};
+        Ring* next = nullptr;
+    };
+
+    static void write(Level level, uint64_t suppressed, const char* fmt, va_list args);
+    static Ring& ring();
+    static Ring* registerRing();
+    static void writerLoop();
+    static size_t drain(std::string& out);
+
+    static std::atomic<Ring*> rings_;
+    static std::atomic<Level> minLevel_;
+};
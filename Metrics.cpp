@@ -0,0 +1,180 @@
+#include "Metrics.h"
+#include <cstdio>
+
+std::atomic<Metrics::Shard*> Metrics::shards_{nullptr};
+
+namespace {
+
+const char* const counterNames[Metrics::COUNTERS] = {
+    "tcp_accepted", "tcp_closed", "tcp_timed_out", "tcp_rejected", "tcp_shed", "tcp_line_too_long",
+    "tcp_handed_off", "tcp_adopted", "unix_accepted",
+    "tcp_bytes_in", "tcp_bytes_out",
+    "udp_datagrams", "udp_batches", "udp_rx_dropped", "udp_tx_dropped",
+    "udp_bytes_in", "udp_bytes_out", "udp_rejected", "udp_shed",
+    "cmd_echo", "cmd_time", "cmd_stats", "cmd_shutdown", "cmd_subscribe", "cmd_unsubscribe", "cmd_publish", "cmd_binary", "cmd_watch", "cmd_shm", "cmd_trace",
+    "cmd_unknown", "pub_published", "pub_delivered", "pub_dropped",
+    "mem_allocs", "mem_reused",
+};
+
+const char* const histogramNames[Metrics::HISTOGRAMS] = {
+    "read_to_reply", "queue_wait", "event_batch", "udp_batch",
+};
+
+/// Гистограммы, значения которых - наносекунды (в Prometheus выводятся в секундах)
+constexpr bool histogramIsTime[Metrics::HISTOGRAMS] = {true, true, false, false};
+}
+
+/**
+ * Регистрация шарда нового потока
+ * @return Шард, в который будет писать текущий поток
+ */
+Metrics::Shard* Metrics::registerShard() {
+    auto* s = new Shard();
+    Shard* head = shards_.load(std::memory_order_relaxed);
+    do {
+        s->next = head;
+    } while (!shards_.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+    return s;
+}
+
+/**
+ * Добавление значения в гистограмму текущего потока
+ * @param h Гистограмма
+ * @param value Значение (наносекунды или штуки)
+ */
+void Metrics::record(Histogram h, uint64_t value) {
+    AtomicHistogram& hist = shard().histograms[static_cast<size_t>(h)];
+    auto bump = [](std::atomic<uint64_t>& v, uint64_t n) {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    };
+    bump(hist.buckets[HistogramData::bucketOf(value)], 1);
+    bump(hist.count, 1);
+    bump(hist.sum, value);
+    if (value > hist.max.load(std::memory_order_relaxed)) hist.max.store(value, std::memory_order_relaxed);
+}
+
+/**
+ * Сбор метрик со всех шардов
+ * Значения разных шардов читаются не атомарно между собой, что допустимо для мониторинга
+ */
+Metrics::Snapshot Metrics::snapshot() {
+    Snapshot snap;
+    for (Shard* s = shards_.load(std::memory_order_acquire); s; s = s->next) {
+        for (size_t i = 0; i < COUNTERS; ++i)
+            snap.counters[i] += s->counters[i].load(std::memory_order_relaxed);
+        for (size_t h = 0; h < HISTOGRAMS; ++h) {
+            const AtomicHistogram& src = s->histograms[h];
+            HistogramData& dst = snap.histograms[h];
+            for (size_t b = 0; b < HistogramData::BUCKETS; ++b)
+                dst.buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+            dst.count += src.count.load(std::memory_order_relaxed);
+            dst.sum += src.sum.load(std::memory_order_relaxed);
+            uint64_t max = src.max.load(std::memory_order_relaxed);
+            if (max > dst.max) dst.max = max;
+        }
+    }
+    return snap;
+}
+
+/**
+ * Номер корзины для значения
+ * Значения меньше 2*SUB хранятся точно, дальше каждая степень двойки делится на SUB корзин
+ */
+size_t Metrics::HistogramData::bucketOf(uint64_t value) {
+    if (value < 2 * SUB) return static_cast<size_t>(value);
+    auto exponent = static_cast<unsigned>(63 - __builtin_clzll(value));
+    auto mantissa = static_cast<size_t>((value >> (exponent - SUB_BITS)) & (SUB - 1));
+    return (exponent - SUB_BITS) * SUB + mantissa + SUB;
+}
+
+/**
+ * Нижняя граница значений корзины
+ */
+uint64_t Metrics::HistogramData::bucketValue(size_t index) {
+    if (index < 2 * SUB) return index;
+    size_t exponent = (index - SUB) / SUB + SUB_BITS;
+    size_t mantissa = (index - SUB) % SUB;
+    return static_cast<uint64_t>(SUB + mantissa) << (exponent - SUB_BITS);
+}
+
+/**
+ * Значение перцентиля
+ * @param p Доля от 0 до 1
+ * @return Нижняя граница корзины, в которую попадает перцентиль (0 для пустой гистограммы)
+ */
+uint64_t Metrics::HistogramData::percentile(double p) const {
+    if (count == 0) return 0;
+    auto rank = static_cast<uint64_t>(p * static_cast<double>(count));
+    if (rank >= count) rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen > rank) return bucketValue(b) < max ? bucketValue(b) : max;
+    }
+    return max;
+}
+
+/**
+ * Добавление значения в локальную (не разделяемую между потоками) гистограмму
+ */
+void Metrics::HistogramData::add(uint64_t value) {
+    buckets[bucketOf(value)]++;
+    count++;
+    sum += value;
+    if (value > max) max = value;
+}
+
+/**
+ * Слияние с другой гистограммой
+ */
+void Metrics::HistogramData::merge(const HistogramData& other) {
+    for (size_t b = 0; b < BUCKETS; ++b) buckets[b] += other.buckets[b];
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) max = other.max;
+}
+
+const char* Metrics::name(Counter c) {
+    return counterNames[static_cast<size_t>(c)];
+}
+
+const char* Metrics::name(Histogram h) {
+    return histogramNames[static_cast<size_t>(h)];
+}
+
+/**
+ * Метрики в текстовом формате Prometheus
+ * Счетчики - counter с суффиксом _total, гистограммы - summary с квантилями
+ */
+std::string Metrics::prometheus() {
+    Snapshot snap = snapshot();
+    std::string out;
+    char line[256];
+
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        std::snprintf(line, sizeof(line), "# TYPE testing_task_%s_total counter\ntesting_task_%s_total %llu\n",
+                      counterNames[i], counterNames[i], static_cast<unsigned long long>(snap.counters[i]));
+        out += line;
+    }
+
+    static constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (size_t h = 0; h < HISTOGRAMS; ++h) {
+        const HistogramData& d = snap.histograms[h];
+        const char* n = histogramNames[h];
+        const char* unit = histogramIsTime[h] ? "_seconds" : "";
+        double scale = histogramIsTime[h] ? 1e-9 : 1.0;
+
+        std::snprintf(line, sizeof(line), "# TYPE testing_task_%s%s summary\n", n, unit);
+        out += line;
+        for (double q : quantiles) {
+            std::snprintf(line, sizeof(line), "testing_task_%s%s{quantile=\"%g\"} %.9g\n",
+                          n, unit, q, static_cast<double>(d.percentile(q)) * scale);
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "testing_task_%s%s_sum %.9g\ntesting_task_%s%s_count %llu\n",
+                      n, unit, static_cast<double>(d.sum) * scale, n, unit,
+                      static_cast<unsigned long long>(d.count));
+        out += line;
+    }
+    return out;
+}
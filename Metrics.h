@@ -0,0 +1,144 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Метрики сервера: счетчики и гистограммы с шардированием по потокам
+ * Каждый поток пишет только в свой шард (обычные load/store без lock-префикса),
+ * суммирование по шардам выполняется лениво при чтении (/stats, /metrics)
+ */
+class Metrics {
+public:
+    /// Монотонно растущие счетчики
+    enum class Counter : size_t {
+        TcpAccepted,        ///< Принятые TCP соединения
+        TcpClosed,          ///< Закрытые TCP соединения
+        TcpTimedOut,        ///< TCP соединения, закрытые по таймауту
+        TcpRejected,        ///< Соединения, отклоненные по лимиту IP или количества соединений
+        TcpShed,            ///< Соединения, сброшенные при перегрузке пула
+        TcpLineTooLong,     ///< Соединения, закрытые из-за слишком длинной строки или кадра
+        TcpHandedOff,       ///< Соединения, переданные новому процессу (--handoff)
+        TcpAdopted,         ///< Соединения, полученные от предыдущего процесса
+        UnixAccepted,       ///< Соединения, принятые через Unix сокет (входят в TcpAccepted)
+        TcpBytesIn,         ///< Байт принято по TCP
+        TcpBytesOut,        ///< Байт отправлено по TCP
+        UdpDatagrams,       ///< Принято UDP датаграмм
+        UdpBatches,         ///< Непустых пачек приема UDP
+        UdpRxDropped,       ///< Датаграммы, отброшенные ядром при переполнении буфера сокета
+        UdpTxDropped,       ///< UDP ответы, которые не удалось отправить
+        UdpBytesIn,         ///< Байт принято по UDP
+        UdpBytesOut,        ///< Байт отправлено по UDP
+        UdpRejected,        ///< Датаграммы, отклоненные по лимиту IP
+        UdpShed,            ///< Датаграммы, сброшенные при перегрузке пула
+        CmdEcho,            ///< Зеркалированные сообщения
+        CmdTime,            ///< Команды /time
+        CmdStats,           ///< Команды /stats
+        CmdShutdown,        ///< Команды /shutdown
+        CmdSubscribe,       ///< Команды /subscribe
+        CmdUnsubscribe,     ///< Команды /unsubscribe
+        CmdPublish,         ///< Команды /publish
+        CmdBinary,          ///< Переходы на двоичный протокол /binary
+        CmdWatch,           ///< Команды /watch
+        CmdShm,             ///< Команды /shm
+        CmdTrace,           ///< Команды /trace
+        CmdUnknown,         ///< Неизвестные команды
+        PubPublished,       ///< Сообщения, опубликованные в каналы с подписчиками
+        PubDelivered,       ///< Сообщения, поставленные в очередь подписчика или отправленные ему
+        PubDropped,         ///< Сообщения, не доставленные подписчику (переполненная очередь, ошибка sendmmsg)
+        MemAllocs,          ///< Блоки буферов, выделенные у системного аллокатора
+        MemReused,          ///< Блоки буферов, выданные из списков свободных BufferPool
+        Count
+    };
+
+    /// Распределения значений
+    enum class Histogram : size_t {
+        ReadToReply,        ///< От получения данных до передачи ответа ядру, нс
+        QueueWait,          ///< Ожидание задачи в очереди пула потоков, нс
+        EventBatch,         ///< Событий за одно пробуждение epoll / io_uring
+        UdpBatch,           ///< Датаграмм в одной пачке приема
+        Count
+    };
+
+    static constexpr size_t COUNTERS = static_cast<size_t>(Counter::Count);
+    static constexpr size_t HISTOGRAMS = static_cast<size_t>(Histogram::Count);
+
+    /**
+     * Гистограмма в стиле HDR: логарифмические диапазоны по 16 линейных корзин,
+     * относительная погрешность не больше 1/16 во всем диапазоне uint64
+     */
+    struct HistogramData {
+        static constexpr unsigned SUB_BITS = 4;
+        static constexpr size_t SUB = size_t{1} << SUB_BITS;
+        static constexpr size_t BUCKETS = (64 - SUB_BITS) * SUB + SUB;
+
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        static size_t bucketOf(uint64_t value);
+        static uint64_t bucketValue(size_t index);
+        uint64_t percentile(double p) const;
+        void add(uint64_t value);
+        void merge(const HistogramData& other);
+    };
+
+    /// Согласованный по шардам срез всех метрик
+    struct Snapshot {
+        std::array<uint64_t, COUNTERS> counters{};
+        std::array<HistogramData, HISTOGRAMS> histograms{};
+
+        uint64_t operator[](Counter c) const { return counters[static_cast<size_t>(c)]; }
+        const HistogramData& operator[](Histogram h) const { return histograms[static_cast<size_t>(h)]; }
+    };
+
+    /// Увеличение счетчика текущего потока
+    static void add(Counter c, uint64_t n = 1) {
+        auto& v = shard().counters[static_cast<size_t>(c)];
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void record(Histogram h, uint64_t value);
+    static Snapshot snapshot();
+    static std::string prometheus();
+
+    static const char* name(Counter c);
+    static const char* name(Histogram h);
+
+    /// Монотонное время в наносекундах для замеров задержек
+    static uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    /// Гистограмма шарда: пишет один поток, читают все
+    struct AtomicHistogram {
+        std::array<std::atomic<uint64_t>, HistogramData::BUCKETS> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    /// Метрики одного потока
+    struct Shard {
+        std::array<std::atomic<uint64_t>, COUNTERS> counters{};
+        std::array<AtomicHistogram, HISTOGRAMS> histograms;
+        Shard* next = nullptr;
+    };
+
+    static Shard& shard() {
+        thread_local Shard* local = nullptr;
+        if (!local) local = registerShard();
+        return *local;
+    }
+
+    static Shard* registerShard();
+
+    /// Список шардов всех потоков; шарды не освобождаются, чтобы значения завершившихся потоков не терялись
+    static std::atomic<Shard*> shards_;
+};
@@ -0,0 +1,128 @@
+#include "MetricsServer.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Конструктор HTTP listener'а метрик
+ * @param port TCP порт
+ * @param render Функция, формирующая текст метрик
+ * @param stopping Функция, сообщающая о завершении работы сервера
+ */
+MetricsServer::MetricsServer(int port, std::function<std::string()> render, std::function<bool()> stopping) :
+    port_(port),
+    render_(std::move(render)),
+    stopping_(std::move(stopping)) {}
+
+MetricsServer::~MetricsServer() {
+    join();
+    if (listenFd_ != -1) close(listenFd_);
+}
+
+/**
+ * Открытие порта и запуск потока обслуживания
+ * @param fd Уже слушающий сокет, полученный от предыдущего процесса (-1 - открыть порт)
+ */
+void MetricsServer::start(int fd) {
+    if (fd >= 0) {
+        listenFd_ = fd;
+        thread_ = std::thread([this] { loop(); });
+        return;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        perror("socket metrics");
+        exit(1);
+    }
+
+    int opt = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind metrics");
+        exit(1);
+    }
+    if (listen(listenFd_, 16) < 0) {
+        perror("listen metrics");
+        exit(1);
+    }
+
+    thread_ = std::thread([this] { loop(); });
+}
+
+/**
+ * Ожидание завершения потока (после установки флага завершения сервера)
+ */
+void MetricsServer::join() {
+    if (thread_.joinable()) thread_.join();
+}
+
+/**
+ * Цикл приема соединений; раз в секунду проверяет флаг завершения
+ */
+void MetricsServer::loop() {
+    while (!stopping_()) {
+        pollfd p{listenFd_, POLLIN, 0};
+        int n = poll(&p, 1, 1000);
+        if (n <= 0) continue;
+
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        serve(fd);
+        close(fd);
+    }
+}
+
+/**
+ * Обработка одного HTTP запроса
+ * Медленный клиент не блокирует поток дольше таймаута сокета
+ * @param fd Принятое соединение
+ */
+void MetricsServer::serve(int fd) {
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Читаем заголовки запроса; тело у GET отсутствует
+    char req[4096];
+    size_t len = 0;
+    while (len < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0) return;
+        len += static_cast<size_t>(n);
+        req[len] = '\0';
+        if (std::strstr(req, "\r\n\r\n") || std::strstr(req, "\n\n")) break;
+    }
+
+    std::string body;
+    const char* status;
+    if (std::strncmp(req, "GET /metrics ", 13) == 0 || std::strncmp(req, "GET /metrics?", 13) == 0) {
+        status = "200 OK";
+        body = render_();
+    } else {
+        status = "404 Not Found";
+        body = "Not Found\n";
+    }
+
+    std::string resp = std::string("HTTP/1.1 ") + status +
+                       "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < resp.size()) {
+        ssize_t n = send(fd, resp.data() + sent, resp.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += static_cast<size_t>(n);
+    }
+}
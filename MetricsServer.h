@@ -0,0 +1,29 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * HTTP listener для сборщика Prometheus
+ * Отвечает на GET /metrics в отдельном потоке, не затрагивая реакторы.
+ * Соединения обслуживаются по одному: запросы редкие, ответ небольшой
+ */
+class MetricsServer {
+public:
+    MetricsServer(int port, std::function<std::string()> render, std::function<bool()> stopping);
+    ~MetricsServer();
+
+    void start(int fd = -1);
+    void join();
+    int fd() const { return listenFd_; }
+
+private:
+    void loop();
+    void serve(int fd);
+
+    int port_;
+    int listenFd_ = -1;
+    std::function<std::string()> render_;     ///< Формирование текста метрик
+    std::function<bool()> stopping_;          ///< Сервер завершает работу
+    std::thread thread_;
+};
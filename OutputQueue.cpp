@@ -0,0 +1,151 @@
+#include "OutputQueue.h"
+#include "FlightRecorder.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstring>
+
+/**
+ * Копирование данных в очередь
+ * Короткие ответы дописываются в общий блок очереди, соседние ответы
+ * склеиваются в один сегмент iovec
+ * @param data Указатель на данные
+ * @param len Длина данных
+ */
+void OutputQueue::push(const char* data, size_t len) {
+    if (len == 0) return;
+    if (!tail_ || tailUsed_ + len > tail_->capacity()) {
+        tail_ = BufferRef::allocate(len > CHUNK_SIZE ? len : CHUNK_SIZE);
+        tailUsed_ = 0;
+    }
+    char* dst = tail_->data() + tailUsed_;
+    std::memcpy(dst, data, len);
+    tailUsed_ += len;
+    append(tail_, dst, len);
+}
+
+/**
+ * Копирование строки в очередь
+ * @param data Данные для отправки
+ */
+void OutputQueue::push(const std::string& data) {
+    push(data.data(), data.size());
+}
+
+/**
+ * Постановка в очередь чужого блока без копирования
+ * @param block Блок, которому принадлежат данные (удерживается до отправки)
+ * @param data Начало данных внутри блока
+ * @param len Длина данных
+ */
+void OutputQueue::pushRef(const BufferRef& block, const char* data, size_t len) {
+    if (len == 0) return;
+    append(block, data, len);
+}
+
+/**
+ * Добавление сегмента; непрерывное продолжение последнего сегмента расширяет его
+ */
+void OutputQueue::append(const BufferRef& block, const char* data, size_t len) {
+    if (count_ > 0) {
+        Segment& last = at(count_ - 1);
+        if (last.block == block && last.data + last.len == data) {
+            last.len += len;
+            pending_ += len;
+            return;
+        }
+    }
+    if (count_ == segments_.size()) grow();
+    at(count_++) = {block, data, len};
+    pending_ += len;
+}
+
+/**
+ * Удвоение кольца сегментов (первое выделение - MIN_SEGMENTS)
+ */
+void OutputQueue::grow() {
+    std::vector<Segment> bigger(segments_.empty() ? MIN_SEGMENTS : segments_.size() * 2);
+    for (size_t i = 0; i < count_; ++i) bigger[i] = std::move(at(i));
+    segments_.swap(bigger);
+    head_ = 0;
+}
+
+/**
+ * Сброс очереди без освобождения кольца сегментов (для повторного использования соединения)
+ */
+void OutputQueue::clear() {
+    for (size_t i = 0; i < count_; ++i) at(i) = Segment{};
+    head_ = count_ = 0;
+    tail_ = BufferRef();
+    tailUsed_ = 0;
+    pending_ = 0;
+}
+
+/**
+ * Заполнение массива iovec сегментами из начала очереди
+ * @param iov Массив для заполнения
+ * @param maxIov Размер массива
+ * @return Количество заполненных элементов
+ */
+int OutputQueue::prepareIov(iovec* iov, int maxIov) const {
+    int count = 0;
+    for (size_t i = 0; i < count_ && count < maxIov; ++i) {
+        const Segment& s = at(i);
+        iov[count].iov_base = const_cast<char*>(s.data);
+        iov[count].iov_len = s.len;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * Удаление отправленных байт из начала очереди
+ * @param n Количество отправленных байт
+ */
+void OutputQueue::consume(size_t n) {
+    pending_ -= n;
+    while (n > 0) {
+        Segment& front = at(0);
+        if (n < front.len) {
+            front.data += n;
+            front.len -= n;
+            return;
+        }
+        n -= front.len;
+        front = Segment{};      // Освобождаем ссылку на блок сразу
+        head_ = (head_ + 1) & (segments_.size() - 1);
+        --count_;
+    }
+    // Все ответы отправлены, блок очереди больше никем не используется - переиспользуем его
+    if (pending_ == 0 && tail_ && tail_->unique()) tailUsed_ = 0;
+}
+
+/**
+ * Отправка накопленных данных
+ * Все сегменты уходят одним sendmsg; при частичной записи повторяем,
+ * пока сокет принимает данные
+ * @param fd Файловый дескриптор клиента
+ * @return Результат отправки
+ */
+OutputQueue::FlushResult OutputQueue::flush(int fd) {
+    while (pending_ > 0) {
+        iovec iov[MAX_IOV];
+        int count = prepareIov(iov, MAX_IOV);
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+
+        // MSG_NOSIGNAL: закрытый клиент не должен убивать сервер через SIGPIPE
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return FlushResult::Blocked;
+            return FlushResult::Error;
+        }
+
+        FlightRecorder::record(FlightRecorder::Event::Send, fd, static_cast<uint64_t>(n));
+        consume(static_cast<size_t>(n));
+    }
+    return FlushResult::Drained;
+}
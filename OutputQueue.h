@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include "Buffer.h"
+
+/**
+ * Очередь исходящих данных TCP соединения
+ * Ответы накапливаются в очереди и отправляются одним вызовом sendmsg (writev),
+ * недоотправленный остаток ждет события EPOLLOUT.
+ * Сегменты ссылаются на блоки BufferBlock: сформированные ответы копируются
+ * в собственный блок очереди, эхо ссылается на байты входного буфера без копирования.
+ * Сегменты хранятся в кольцевом буфере, который только растет, поэтому
+ * в установившемся режиме очередь не обращается к аллокатору
+ */
+class OutputQueue {
+public:
+    static constexpr int MAX_IOV = 64;           ///< Максимум сегментов в одном sendmsg
+
+    /// Результат попытки отправки
+    enum class FlushResult {
+        Drained,    ///< Очередь полностью отправлена
+        Blocked,    ///< Буфер сокета заполнен (EAGAIN), нужно ждать EPOLLOUT
+        Error       ///< Ошибка сокета, соединение нужно закрыть
+    };
+
+    void push(const char* data, size_t len);
+    void push(const std::string& data);
+    void pushRef(const BufferRef& block, const char* data, size_t len);
+    FlushResult flush(int fd);
+
+    // Для асинхронной отправки (io_uring): заполнить iovec и отметить отправленное
+    int prepareIov(iovec* iov, int maxIov) const;
+    void consume(size_t n);
+
+    size_t pending() const { return pending_; }
+    bool empty() const { return pending_ == 0; }
+
+    void clear();
+
+private:
+    /// Непрерывный участок данных внутри блока
+    struct Segment {
+        BufferRef block;
+        const char* data = nullptr;
+        size_t len = 0;
+    };
+
+    static constexpr size_t CHUNK_SIZE = 4096;   ///< Размер блока для копируемых ответов
+    static constexpr size_t MIN_SEGMENTS = 16;   ///< Начальная емкость кольца сегментов
+
+    void append(const BufferRef& block, const char* data, size_t len);
+    Segment& at(size_t i) { return segments_[(head_ + i) & (segments_.size() - 1)]; }
+    const Segment& at(size_t i) const { return segments_[(head_ + i) & (segments_.size() - 1)]; }
+    void grow();
+
+    std::vector<Segment> segments_;   ///< Кольцо сегментов, размер - степень двойки
+    size_t head_ = 0;           ///< Индекс первого сегмента
+    size_t count_ = 0;          ///< Сегментов в очереди
+    BufferRef tail_;            ///< Блок, в который копируются сформированные ответы
+    size_t tailUsed_ = 0;       ///< Занятая часть tail_
+    size_t pending_ = 0;        ///< Всего байт ожидает отправки
+};
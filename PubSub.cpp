@@ -0,0 +1,365 @@
+#include "PubSub.h"
+#include "ConnectionTable.h"
+#include "Metrics.h"
+#include "UdpPeerTracker.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+/**
+ * Конструктор
+ * @param reactors Реакторы сервера: почтовые ящики TCP соединений и UDP сокеты
+ * @param udpTtlSeconds Время жизни подписки UDP без повторного /subscribe
+ */
+PubSub::PubSub(const std::vector<std::unique_ptr<Reactor>>& reactors, uint32_t udpTtlSeconds) :
+    reactors_(reactors),
+    shards_(std::make_unique<Shard[]>(SHARDS)),
+    udpTtl_(udpTtlSeconds > 0 ? udpTtlSeconds : 1) {}
+
+/**
+ * Монотонное время в секундах
+ */
+uint32_t PubSub::nowSeconds() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
+
+/**
+ * Проверка имени канала: непустое, без пробелов, не длиннее MAX_CHANNEL
+ */
+bool PubSub::validChannel(std::string_view channel) {
+    return !channel.empty() && channel.size() <= MAX_CHANNEL && channel.find(' ') == std::string_view::npos;
+}
+
+/**
+ * Шард канала (FNV-1a от имени)
+ */
+PubSub::Shard& PubSub::shard(std::string_view channel) {
+    uint32_t h = 2166136261u;
+    for (char ch : channel) {
+        h ^= static_cast<uint8_t>(ch);
+        h *= 16777619u;
+    }
+    return shards_[h % SHARDS];
+}
+
+/**
+ * Подписка TCP соединения; вызывается потоком, обрабатывающим соединение
+ * @param channel Имя канала
+ * @param c Клиент
+ * @return false, если превышен предел подписок соединения
+ */
+bool PubSub::subscribe(std::string_view channel, Client& c) {
+    if (std::find(c.channels.begin(), c.channels.end(), channel) != c.channels.end()) return true;
+    if (c.channels.size() >= MAX_CLIENT_CHANNELS) return false;
+
+    Shard& s = shard(channel);
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.channels.find(channel);
+        if (it == s.channels.end()) it = s.channels.emplace(std::string(channel), Channel{}).first;
+        it->second.tcp[ConnectionTable::token(c.fd, c.generation)] = c.reactor;
+    }
+    c.channels.emplace_back(channel);
+    return true;
+}
+
+/**
+ * Подписка UDP пира или ее продление; сообщения уходят с UDP сокета реактора,
+ * принявшего подписку. Без повторного /subscribe подписка истекает через TTL пира
+ * @param channel Имя канала
+ * @param peer Адрес пира
+ * @param reactor Номер реактора
+ * @return false, если превышен общий предел подписок UDP или предел IP адреса
+ */
+bool PubSub::subscribe(std::string_view channel, const sockaddr_in& peer, int reactor) {
+    uint64_t key = UdpPeerTracker::packKey(peer);
+    uint32_t now = nowSeconds();
+    Shard& s = shard(channel);
+    for (bool swept = false;; swept = true) {
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.channels.find(channel);
+            if (it != s.channels.end()) {
+                auto sub = it->second.udp.find(key);
+                if (sub != it->second.udp.end()) {
+                    sub->second = {reactor, now + udpTtl_};
+                    return true;
+                }
+            }
+            if (reserveUdp(key)) {
+                if (it == s.channels.end()) it = s.channels.emplace(std::string(channel), Channel{}).first;
+                it->second.udp.emplace(key, UdpSubscription{reactor, now + udpTtl_});
+                return true;
+            }
+        }
+        // Пределы заняты: место могут освободить истекшие подписки (очистка не чаще раза в секунду)
+        if (swept || !sweepUdp(now)) return false;
+    }
+}
+
+/**
+ * Учет новой подписки UDP в общем пределе и пределе IP адреса
+ * @param key Упакованный адрес пира
+ * @return false, если один из пределов исчерпан
+ */
+bool PubSub::reserveUdp(uint64_t key) {
+    auto source = static_cast<uint32_t>(key >> 16);
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    if (udpSubscriptions_ >= MAX_UDP_SUBSCRIPTIONS) return false;
+    uint32_t& count = sources_[source];
+    if (count >= MAX_UDP_PER_SOURCE) return false;
+    count++;
+    udpSubscriptions_++;
+    return true;
+}
+
+/**
+ * Снятие подписок UDP с учета
+ * @param key Упакованный адрес пира
+ * @param count Количество снятых подписок
+ */
+void PubSub::releaseUdp(uint64_t key, size_t count) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    udpSubscriptions_ -= count;
+    auto it = sources_.find(static_cast<uint32_t>(key >> 16));
+    if (it != sources_.end() && (it->second -= static_cast<uint32_t>(count)) == 0) sources_.erase(it);
+}
+
+/**
+ * Удаление истекших подписок UDP во всех каналах
+ * @param now Текущее время в секундах
+ * @return false, если в эту секунду очистка уже выполнялась
+ */
+bool PubSub::sweepUdp(uint32_t now) {
+    uint32_t last = lastSweep_.load(std::memory_order_relaxed);
+    if (last == now || !lastSweep_.compare_exchange_strong(last, now, std::memory_order_relaxed)) return false;
+    for (size_t i = 0; i < SHARDS; ++i) {
+        Shard& s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto it = s.channels.begin(); it != s.channels.end();) {
+            auto& udp = it->second.udp;
+            for (auto sub = udp.begin(); sub != udp.end();) {
+                if (now < sub->second.expires) {
+                    ++sub;
+                    continue;
+                }
+                releaseUdp(sub->first);
+                sub = udp.erase(sub);
+            }
+            if (it->second.tcp.empty() && udp.empty()) it = s.channels.erase(it);
+            else ++it;
+        }
+    }
+    return true;
+}
+
+/**
+ * Удаление подписчика из канала; пустой канал удаляется
+ * @return true, если подписчик был в канале
+ */
+bool PubSub::erase(std::string_view channel, bool udp, uint64_t key) {
+    Shard& s = shard(channel);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.channels.find(channel);
+    if (it == s.channels.end()) return false;
+    Channel& ch = it->second;
+    bool erased = (udp ? ch.udp.erase(key) : ch.tcp.erase(key)) > 0;
+    if (ch.tcp.empty() && ch.udp.empty()) s.channels.erase(it);
+    return erased;
+}
+
+/**
+ * Отписка TCP соединения от канала
+ * @return true, если соединение было подписано
+ */
+bool PubSub::unsubscribe(std::string_view channel, Client& c) {
+    auto it = std::find(c.channels.begin(), c.channels.end(), channel);
+    if (it == c.channels.end()) return false;
+    erase(channel, false, ConnectionTable::token(c.fd, c.generation));
+    c.channels.erase(it);
+    return true;
+}
+
+/**
+ * Отписка UDP пира от канала
+ * @return true, если пир был подписан
+ */
+bool PubSub::unsubscribe(std::string_view channel, const sockaddr_in& peer) {
+    uint64_t key = UdpPeerTracker::packKey(peer);
+    if (!erase(channel, true, key)) return false;
+    releaseUdp(key);
+    return true;
+}
+
+/**
+ * Отписка TCP соединения от всех каналов (команда или закрытие соединения)
+ * @return Количество снятых подписок
+ */
+size_t PubSub::unsubscribeAll(Client& c) {
+    uint64_t token = ConnectionTable::token(c.fd, c.generation);
+    for (const std::string& channel : c.channels) erase(channel, false, token);
+    size_t count = c.channels.size();
+    c.channels.clear();
+    return count;
+}
+
+/**
+ * Отписка UDP пира от всех каналов
+ * Список каналов пира не хранится, поэтому обходятся все шарды
+ * @return Количество снятых подписок
+ */
+size_t PubSub::unsubscribeAll(const sockaddr_in& peer) {
+    uint64_t key = UdpPeerTracker::packKey(peer);
+    size_t count = 0;
+    for (size_t i = 0; i < SHARDS; ++i) {
+        Shard& s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto it = s.channels.begin(); it != s.channels.end();) {
+            Channel& ch = it->second;
+            count += ch.udp.erase(key);
+            if (ch.tcp.empty() && ch.udp.empty()) it = s.channels.erase(it);
+            else ++it;
+        }
+    }
+    releaseUdp(key, count);
+    return count;
+}
+
+/**
+ * Публикация сообщения в канал
+ * Под блокировкой шарда подписчики только копируются; сообщение записывается в один блок,
+ * который разделяют все получатели
+ * @param channel Имя канала
+ * @param msg Сообщение без '\n'
+ * @return Количество подписчиков, которым отправлено сообщение
+ */
+size_t PubSub::publish(std::string_view channel, std::string_view msg) {
+    thread_local std::vector<Target> tcp;
+    thread_local std::vector<Target> udp;
+    tcp.clear();
+    udp.clear();
+    {
+        Shard& s = shard(channel);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.channels.find(channel);
+        if (it == s.channels.end()) return 0;
+        for (const auto& [token, reactor] : it->second.tcp) tcp.push_back({token, reactor});
+        // Истекшие подписки UDP снимаются здесь же: сообщение им не отправляется
+        uint32_t now = nowSeconds();
+        auto& subs = it->second.udp;
+        for (auto sub = subs.begin(); sub != subs.end();) {
+            if (now >= sub->second.expires) {
+                releaseUdp(sub->first);
+                sub = subs.erase(sub);
+                continue;
+            }
+            udp.push_back({sub->first, sub->second.reactor});
+            ++sub;
+        }
+        if (it->second.tcp.empty() && subs.empty()) {
+            s.channels.erase(it);
+            return 0;
+        }
+    }
+    Metrics::add(Metrics::Counter::PubPublished);
+
+    // TCP получателям сообщение нужно с '\n', UDP - без него: блок один на всех
+    auto len = static_cast<uint32_t>(msg.size() + 1);
+    BufferRef block = BufferRef::allocate(len);
+    std::memcpy(block->data(), msg.data(), msg.size());
+    block->data()[msg.size()] = '\n';
+
+    if (!tcp.empty()) post(tcp, block, len);
+    if (!udp.empty()) send(udp, block->data(), msg.size());
+    return tcp.size() + udp.size();
+}
+
+/**
+ * Постановка сообщения в почтовые ящики реакторов TCP подписчиков
+ * Одна блокировка ящика и одно пробуждение на реактор, а не на подписчика
+ */
+void PubSub::post(std::vector<Target>& targets, const BufferRef& block, uint32_t len) {
+    std::sort(targets.begin(), targets.end(), [](const Target& a, const Target& b) { return a.reactor < b.reactor; });
+
+    for (size_t i = 0; i < targets.size();) {
+        int reactor = targets[i].reactor;
+        Reactor& r = *reactors_[static_cast<size_t>(reactor)];
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(r.mailMutex);
+            // Непустой ящик уже ждет разбора - eventfd взведен
+            wake = r.mail.empty();
+            for (; i < targets.size() && targets[i].reactor == reactor; ++i)
+                r.mail.push_back({targets[i].key, block, len});
+        }
+        if (wake) {
+            uint64_t one = 1;
+            while (write(r.mailFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+        }
+    }
+}
+
+/**
+ * Отправка сообщения UDP подписчикам пачками sendmmsg
+ * Все датаграммы пачки ссылаются на один и тот же буфер
+ */
+void PubSub::send(std::vector<Target>& targets, const char* data, size_t len) {
+    std::sort(targets.begin(), targets.end(), [](const Target& a, const Target& b) { return a.reactor < b.reactor; });
+
+    iovec iov{const_cast<char*>(data), len};
+    sockaddr_in addrs[UDP_BATCH];
+    mmsghdr msgs[UDP_BATCH];
+    uint64_t sent = 0, dropped = 0;
+
+    for (size_t i = 0; i < targets.size();) {
+        int reactor = targets[i].reactor;
+        int fd = reactors_[static_cast<size_t>(reactor)]->udpFd;
+        unsigned n = 0;
+        for (; i < targets.size() && targets[i].reactor == reactor && n < UDP_BATCH; ++i, ++n) {
+            uint64_t key = targets[i].key;
+            addrs[n] = sockaddr_in{};
+            addrs[n].sin_family = AF_INET;
+            addrs[n].sin_addr.s_addr = htonl(static_cast<uint32_t>(key >> 16));
+            addrs[n].sin_port = htons(static_cast<uint16_t>(key));
+            msgs[n] = mmsghdr{};
+            msgs[n].msg_hdr.msg_name = &addrs[n];
+            msgs[n].msg_hdr.msg_namelen = sizeof(addrs[n]);
+            msgs[n].msg_hdr.msg_iov = &iov;
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        // sendmmsg останавливается на первой ошибке: датаграмма пропускается, остаток отправляется заново
+        for (unsigned done = 0; done < n;) {
+            int ret = sendmmsg(fd, msgs + done, n - done, 0);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                ++dropped;
+                ++done;
+                continue;
+            }
+            sent += static_cast<unsigned>(ret);
+            done += static_cast<unsigned>(ret);
+        }
+    }
+
+    Metrics::add(Metrics::Counter::PubDelivered, sent);
+    Metrics::add(Metrics::Counter::UdpBytesOut, sent * len);
+    if (dropped) Metrics::add(Metrics::Counter::PubDropped, dropped);
+}
+
+/**
+ * Перенос сообщений из почтового ящика реактора в r.delivering
+ * Вызывается потоком реактора после сброса eventfd
+ * @param r Реактор
+ */
+void PubSub::take(Reactor& r) {
+    r.delivering.clear();
+    std::lock_guard<std::mutex> lock(r.mailMutex);
+    r.mail.swap(r.delivering);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+#include "Client.h"
+#include "Reactor.h"
+
+/**
+ * Каналы публикации/подписки
+ * Подписчики хранятся в шардах по хэшу имени канала, у каждого шарда своя блокировка,
+ * поэтому публикации в разные каналы не конкурируют. Сообщение сериализуется один раз
+ * в BufferBlock, подписчики получают ссылки на него:
+ * TCP - через почтовый ящик реактора, владеющего соединением (очередь ответов меняет
+ * только его поток), UDP - sendmmsg с сокета реактора, принявшего подписку.
+ * Адрес UDP подписчика можно подделать, поэтому подписка UDP живет TTL пира
+ * (--udp-peer-ttl) и продлевается повторным /subscribe, а на один IP адрес
+ * приходится не больше MAX_UDP_PER_SOURCE подписок: публикация не превращается
+ * в поток датаграмм на чужой адрес
+ */
+class PubSub {
+public:
+    static constexpr size_t MAX_CHANNEL = 64;                 ///< Предел длины имени канала
+    static constexpr size_t MAX_CLIENT_CHANNELS = 64;         ///< Подписок на одно TCP соединение
+    static constexpr size_t MAX_UDP_SUBSCRIPTIONS = 1 << 16;  ///< Подписок UDP пиров всего
+    static constexpr uint32_t MAX_UDP_PER_SOURCE = 16;        ///< Подписок UDP с одного IP адреса (все порты и каналы)
+
+    PubSub(const std::vector<std::unique_ptr<Reactor>>& reactors, uint32_t udpTtlSeconds);
+
+    static bool validChannel(std::string_view channel);
+
+    bool subscribe(std::string_view channel, Client& c);
+    bool subscribe(std::string_view channel, const sockaddr_in& peer, int reactor);
+    bool unsubscribe(std::string_view channel, Client& c);
+    bool unsubscribe(std::string_view channel, const sockaddr_in& peer);
+    size_t unsubscribeAll(Client& c);
+    size_t unsubscribeAll(const sockaddr_in& peer);
+    size_t publish(std::string_view channel, std::string_view msg);
+
+    static void take(Reactor& r);
+
+private:
+    static constexpr size_t SHARDS = 16;
+    static constexpr unsigned UDP_BATCH = 64;    ///< Датаграмм в одном sendmmsg
+
+    /// Подписка UDP пира
+    struct UdpSubscription {
+        int reactor;
+        uint32_t expires;       ///< Секунда, после которой подписка снимается без продления
+    };
+
+    /// Подписчики канала: ключ - идентификатор соединения или упакованный адрес пира
+    struct Channel {
+        std::unordered_map<uint64_t, int> tcp;                  ///< Значение - реактор соединения
+        std::unordered_map<uint64_t, UdpSubscription> udp;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::map<std::string, Channel, std::less<>> channels;
+    };
+
+    /// Получатель сообщения, скопированный из канала до отправки
+    struct Target {
+        uint64_t key;
+        int reactor;
+    };
+
+    Shard& shard(std::string_view channel);
+    bool erase(std::string_view channel, bool udp, uint64_t key);
+    bool reserveUdp(uint64_t key);
+    void releaseUdp(uint64_t key, size_t count = 1);
+    bool sweepUdp(uint32_t now);
+    static uint32_t nowSeconds();
+    void post(std::vector<Target>& targets, const BufferRef& block, uint32_t len);
+    void send(std::vector<Target>& targets, const char* data, size_t len);
+
+    const std::vector<std::unique_ptr<Reactor>>& reactors_;
+    std::unique_ptr<Shard[]> shards_;
+    uint32_t udpTtl_;
+    std::mutex sourcesMutex_;                               ///< Защищает sources_ и udpSubscriptions_
+    std::unordered_map<uint32_t, uint32_t> sources_;        ///< Подписок UDP на IP адрес
+    size_t udpSubscriptions_ = 0;
+    std::atomic<uint32_t> lastSweep_{0};                    ///< Секунда последней очистки истекших подписок
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include "Buffer.h"
+#include "Client.h"
+#include "TimerWheel.h"
+#include "UdpBatch.h"
+
+/**
+ * Сообщение канала PubSub для TCP соединения реактора
+ * Блок общий для всех подписчиков сообщения
+ */
+struct Delivery
+{
+    uint64_t token;              ///< Идентификатор соединения (fd и поколение)
+    BufferRef block;             ///< Сообщение вместе с '\n'
+    uint32_t len;                ///< Длина сообщения в блоке
+};
+
+/**
+ * TCP соединение, полученное от предыдущего процесса (--handoff)
+ * Регистрируется потоком реактора вместе с состоянием разбора
+ */
+struct Adoption
+{
+    int fd;
+    sockaddr_in addr;
+    Client::Protocol protocol;
+    std::string input;           ///< Принятые, но еще не разобранные байты
+    std::string channels;        ///< Каналы PubSub через пробел
+};
+
+/**
+ * Состояние одного реактора (цикла обработки событий)
+ * В классическом режиме реактор один и события уходят в пул потоков,
+ * в режиме --reactors N каждый реактор владеет своими сокетами (SO_REUSEPORT),
+ * своим epoll и обрабатывает события сам; таблица соединений общая (индекс - fd)
+ */
+struct Reactor
+{
+    int id = 0;                                  ///< Порядковый номер реактора
+    int epollFd = -1;                            ///< Собственный epoll instance
+    int listenFd = -1;                           ///< TCP сокет для приема соединений
+    int udpFd = -1;                              ///< UDP сокет
+    int unixFd = -1;                             ///< Unix сокет клиентов той же машины (общий для всех реакторов)
+    std::unique_ptr<UdpBatch> udpBatch;          ///< Буферы пакетного приема UDP (epoll backend)
+    std::atomic<bool> udpBacklog{false};         ///< В UDP сокете остались датаграммы сверх бюджета события
+    std::thread thread;                          ///< Поток реактора (только в режиме --reactors)
+    std::mutex timersMutex;                      ///< Защищает timers: соединения ставятся и снимаются из потоков пула
+    TimerWheel timers;                           ///< Таймауты соединений, принятых реактором
+    std::vector<uint64_t> expired;               ///< Соединения с истекшим таймаутом (буфер цикла реактора)
+    std::vector<uint64_t> woken;                 ///< Соединения, чья сопрограмма дождалась sleep (буфер цикла реактора)
+    int mailFd = -1;                             ///< eventfd: в почтовом ящике появились сообщения
+    std::mutex mailMutex;                        ///< Защищает mail: сообщения ставят потоки издателей
+    std::vector<Delivery> mail;                  ///< Почтовый ящик: сообщения каналов для соединений реактора
+    std::vector<Delivery> delivering;            ///< Разбираемые сообщения (буфер цикла реактора)
+    std::vector<Adoption> adoptions;             ///< Соединения от предыдущего процесса (под mailMutex)
+};
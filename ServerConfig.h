@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Logger.h"
+#include "UdpPeerTracker.h"
+
+/**
+ * Параметры запуска сервера
+ * Заполняется из аргументов командной строки в main.cpp
+ */
+struct ServerConfig
+{
+    /// Механизм ввода-вывода
+    enum class Backend {
+        Epoll,      ///< epoll (по умолчанию)
+        Uring       ///< io_uring (multishot accept/recv, пакетная отправка)
+    };
+
+    int port = 8080;                        ///< Порт TCP и UDP
+    int threads = 4;                        ///< Количество потоков в пуле
+    std::string shutdownToken;              ///< Токен для команды /shutdown
+    int reactors = 0;                       ///< Количество реакторов (0 - один epoll цикл с пулом потоков)
+    size_t outHighWater = 1024 * 1024;      ///< Порог очереди ответов, после которого чтение от клиента приостанавливается
+    Backend backend = Backend::Epoll;       ///< Механизм ввода-вывода
+    UdpPeerTracker::Mode udpPeers = UdpPeerTracker::Mode::Exact;   ///< Подсчет уникальных UDP пиров
+    uint32_t udpPeerTtl = 300;              ///< Время жизни записи о UDP пире, секунды
+    size_t udpPeerMax = 1 << 20;            ///< Предел количества отслеживаемых UDP пиров
+    Logger::Level logLevel = Logger::Level::Info;   ///< Минимальный уровень сообщений лога
+    std::string logDir;                     ///< Каталог файла лога (пусто - stdout)
+    int metricsPort = 0;                    ///< Порт HTTP /metrics для Prometheus (0 - выключен)
+    bool udpGso = false;                    ///< Склеивать ответы одному UDP пиру через UDP_SEGMENT
+    uint32_t idleTimeout = 0;               ///< Закрытие соединения без приема и отправки данных, секунды (0 - нет)
+    uint32_t lineTimeout = 0;               ///< Предел времени на досылку строки до '\n', секунды (0 - нет)
+    uint32_t maxLifetime = 0;               ///< Предел времени жизни соединения, секунды (0 - нет)
+    double acceptRate = 0;                  ///< Новых TCP соединений в секунду с одного IP (0 - без ограничения)
+    double acceptBurst = 0;                 ///< Допустимый всплеск соединений с одного IP (0 - равен acceptRate)
+    double udpRate = 0;                     ///< UDP датаграмм в секунду с одного IP (0 - без ограничения)
+    double udpBurst = 0;                    ///< Допустимый всплеск датаграмм с одного IP (0 - равен udpRate)
+    size_t maxLine = 64 * 1024;             ///< Предел длины строки TCP, байт (0 - без ограничения)
+    size_t maxFrame = 16 * 1024 * 1024;     ///< Предел нагрузки кадра двоичного протокола, байт (1 байт - 1 ГБ)
+    size_t maxConnections = 0;              ///< Предел одновременных TCP соединений (0 - без ограничения)
+    size_t maxInflight = 0;                 ///< Предел задач в очередях пула, сверх него новая работа сбрасывается (0 - нет)
+    bool latencyMode = false;               ///< Опрос вместо сна и SO_BUSY_POLL: задержка важнее простаивающего CPU
+    uint32_t spinUs = 50;                   ///< Бюджет опроса перед засыпанием в режиме низкой задержки, мкс
+    std::vector<int> cpuList;               ///< Ядра для реакторов, затем потоков пула (пусто - реакторы по номеру)
+    std::string handoffPath;                ///< Unix сокет передачи работы при обновлении (пусто - выключено)
+    uint32_t drainTimeout = 30;             ///< Предел доработки соединений после передачи, секунды
+    std::string unixPath = "/var/lib/testing-task/server.sock";  ///< Unix сокет клиентов той же машины (пусто - выключен)
+    uint32_t traceWindow = 10;              ///< Секунд последних событий в дампе самописца (0 - самописец выключен)
+    std::string traceDir = "/var/log/testing-task";   ///< Каталог дампов самописца (SIGUSR1, /trace)
+};
@@ -0,0 +1,90 @@
+#include "Session.h"
+#include "BufferPool.h"
+#include "Client.h"
+#include "EpollServer.h"
+#include <cstring>
+
+namespace {
+
+/// Заголовок кадра сопрограммы с классом размера BufferPool; сохраняет выравнивание кадра
+constexpr size_t FRAME_HEADER = alignof(std::max_align_t);
+
+} // namespace
+
+/**
+ * Выделение кадра сопрограммы из BufferPool: частые команды не обращаются к malloc
+ */
+void* SessionTask::promise_type::operator new(size_t size) {
+    size_t capacity = size;
+    uint32_t sizeClass;
+    auto* mem = static_cast<char*>(BufferPool::allocate(FRAME_HEADER, capacity, sizeClass));
+    std::memcpy(mem, &sizeClass, sizeof(sizeClass));
+    return mem + FRAME_HEADER;
+}
+
+void SessionTask::promise_type::operator delete(void* frame, size_t) {
+    char* mem = static_cast<char*>(frame) - FRAME_HEADER;
+    uint32_t sizeClass;
+    std::memcpy(&sizeClass, mem, sizeof(sizeClass));
+    BufferPool::deallocate(mem, sizeClass);
+}
+
+/**
+ * Привязка к соединению; вызывается до запуска сопрограммы, которая сразу может писать ответы
+ * @param server Сервер (порог очереди ответов, колесо таймеров)
+ * @param client Клиент, которому принадлежит сессия
+ */
+void Session::attach(EpollServer& server, Client& client) {
+    server_ = &server;
+    client_ = &client;
+}
+
+/**
+ * Прием запущенной сопрограммы
+ * Завершившаяся без ожидания сопрограмма освобождается сразу
+ * @param task Сопрограмма команды
+ */
+void Session::adopt(SessionTask task) {
+    if (task.handle.done()) {
+        task.handle.destroy();
+        return;
+    }
+    handle_ = task.handle;
+}
+
+/**
+ * Возобновление сопрограммы после события, которого она ждала
+ * @param line Строка для readLine (для остальных ожиданий не используется)
+ */
+void Session::resume(std::string_view line) {
+    if (wait_ == Wait::Line) line_.assign(line.data(), line.size());
+    wait_ = Wait::None;
+    handle_.resume();
+}
+
+/**
+ * Освобождение кадра сопрограммы (завершение или закрытие соединения)
+ * Таймер sleep к этому моменту должен быть снят с колеса
+ */
+void Session::reset() {
+    if (handle_) handle_.destroy();
+    handle_ = nullptr;
+    wait_ = Wait::None;
+    line_.clear();
+}
+
+/**
+ * Постановка строки в очередь ответов
+ * Ожидание нужно, только если очередь выше порога --high-water: клиент не забирает ответы
+ * @param text Текст без '\n'
+ */
+Session::WriteAwaiter Session::write(std::string_view text) {
+    client_->out.push(text.data(), text.size());
+    client_->out.push("\n", 1);
+    return {*this, client_->out.pending() <= server_->outHighWater()};
+}
+
+void Session::SleepAwaiter::await_suspend(std::coroutine_handle<>) {
+    session.wait_ = Wait::Sleep;
+    session.server_->scheduleWake(*session.client_, ms);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <string_view>
+#include "TimerWheel.h"
+
+class EpollServer;
+struct Client;
+
+/**
+ * Сопрограмма команды TCP соединения
+ * Начинает выполняться сразу при вызове; кадр освобождает Session после завершения
+ * или при закрытии соединения. Кадры берутся из BufferPool
+ */
+struct SessionTask {
+    struct promise_type {
+        SessionTask get_return_object() {
+            return SessionTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size);
+        static void operator delete(void* frame, size_t size);
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Многошаговая команда TCP соединения (текстовый протокол), написанная сопрограммой:
+ * co_await readLine(), write(text), sleep(ms) вместо автомата состояний.
+ * Сопрограмма возобновляется потоком, который обрабатывает соединение (реактор или
+ * поток пула, за которым закреплен fd), поэтому работает с клиентом без блокировок.
+ * Пока она выполняется, следующие строки соединения ждут во входном буфере и
+ * отдаются ей через readLine; после ее завершения разбираются как обычно.
+ * Точность sleep - шаг колеса таймеров реактора
+ */
+class Session {
+public:
+    /// Чего ждет сопрограмма
+    enum class Wait : uint8_t {
+        None,
+        Line,       ///< Следующей строки соединения
+        Write,      ///< Опустошения очереди ответов ниже половины порога --high-water
+        Sleep       ///< Срабатывания таймера
+    };
+
+    Session() = default;
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    ~Session() { reset(); }
+
+    void attach(EpollServer& server, Client& client);
+    void adopt(SessionTask task);
+    void resume(std::string_view line = {});
+    void reset();
+
+    bool active() const { return static_cast<bool>(handle_); }
+    bool done() const { return handle_ && handle_.done(); }
+    Wait waiting() const { return wait_; }
+    TimerWheel::Node& timer() { return timer_; }
+
+    struct LineAwaiter {
+        Session& session;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) noexcept { session.wait_ = Wait::Line; }
+        std::string await_resume() noexcept { return std::move(session.line_); }
+    };
+
+    struct WriteAwaiter {
+        Session& session;
+        bool ready;
+        bool await_ready() const noexcept { return ready; }
+        void await_suspend(std::coroutine_handle<>) noexcept { session.wait_ = Wait::Write; }
+        void await_resume() const noexcept {}
+    };
+
+    struct SleepAwaiter {
+        Session& session;
+        uint64_t ms;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>);
+        void await_resume() const noexcept {}
+    };
+
+    /// Следующая строка соединения без '\n'
+    LineAwaiter readLine() { return {*this}; }
+    WriteAwaiter write(std::string_view text);
+    SleepAwaiter sleep(uint64_t ms) { return {*this, ms}; }
+
+private:
+    EpollServer* server_ = nullptr;
+    Client* client_ = nullptr;
+    std::coroutine_handle<> handle_;
+    Wait wait_ = Wait::None;
+    std::string line_;               ///< Строка для readLine
+    TimerWheel::Node timer_;         ///< Таймер sleep в колесе реактора (под Reactor::timersMutex)
+};
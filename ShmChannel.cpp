@@ -0,0 +1,141 @@
+#include "ShmChannel.h"
+#include "Logger.h"
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace {
+Logger::RateLimit corruptLog(10);
+}
+
+ShmChannel::~ShmChannel() {
+    if (layout_) munmap(layout_, sizeof(ShmLayout));
+    if (memFd_ != -1) close(memFd_);
+    if (requestFd_ != -1) close(requestFd_);
+    if (replyFd_ != -1) close(replyFd_);
+}
+
+/**
+ * Создание колец в memfd и eventfd пробуждения
+ * @return Канал или nullptr, если ресурсы не выделены (ошибка записана в лог)
+ */
+std::unique_ptr<ShmChannel> ShmChannel::create() {
+    static Logger::RateLimit errorLog(10);
+    std::unique_ptr<ShmChannel> ch(new ShmChannel());
+
+    ch->memFd_ = memfd_create("testing-task-shm", MFD_CLOEXEC);
+    if (ch->memFd_ < 0 || ftruncate(ch->memFd_, sizeof(ShmLayout)) < 0) {
+        Logger::log(errorLog, Logger::Level::Error, "memfd: %s", strerror(errno));
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, sizeof(ShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, ch->memFd_, 0);
+    if (mem == MAP_FAILED) {
+        Logger::log(errorLog, Logger::Level::Error, "mmap shm: %s", strerror(errno));
+        return nullptr;
+    }
+    ch->layout_ = new (mem) ShmLayout();
+
+    ch->requestFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ch->replyFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ch->requestFd_ < 0 || ch->replyFd_ < 0) {
+        Logger::log(errorLog, Logger::Level::Error, "eventfd: %s", strerror(errno));
+        return nullptr;
+    }
+    return ch;
+}
+
+/**
+ * Передача memfd и eventfd клиенту через SCM_RIGHTS вместе с текстом ответа
+ * После передачи memfd серверу не нужен: отображение остается
+ * @param socketFd Unix сокет клиента
+ * @param text Текст ответа
+ * @param len Длина текста
+ * @return false, если передать не удалось
+ */
+bool ShmChannel::sendTo(int socketFd, const char* text, size_t len) {
+    int fds[3] = {memFd_, requestFd_, replyFd_};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    iovec iov{const_cast<char*>(text), len};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    if (sendmsg(socketFd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) != static_cast<ssize_t>(len)) return false;
+    close(memFd_);
+    memFd_ = -1;
+    return true;
+}
+
+/**
+ * Перенос запросов из кольца во входной буфер клиента
+ * Если клиент ждал места в кольце запросов, он будится
+ * @param in Входной буфер
+ * @param hint Минимум свободного места для prepare
+ * @return Перенесено байт (0 - кольцо пусто), -1 - клиент испортил индексы кольца
+ */
+ssize_t ShmChannel::receive(InputBuffer& in, size_t hint) {
+    ShmRing& ring = layout_->requests;
+    if (ring.readable() == 0) return 0;
+    size_t room;
+    char* dst = in.prepare(hint, room);
+    size_t n = ring.read(dst, room);
+    if (n == ShmRing::CORRUPT) {
+        Logger::log(corruptLog, Logger::Level::Warn, "Shared memory request ring corrupted by client");
+        return -1;
+    }
+    in.commit(n);
+    if (ring.takeWaiting()) signal(replyFd_);
+    return static_cast<ssize_t>(n);
+}
+
+/**
+ * Перенос очереди ответов в кольцо ответов и пробуждение клиента
+ * @param out Очередь ответов
+ * @return Drained; Blocked, если кольцо заполнено: клиент разбудит сервер,
+ *         освободив место; Error, если клиент испортил индексы кольца
+ */
+OutputQueue::FlushResult ShmChannel::flush(OutputQueue& out) {
+    ShmRing& ring = layout_->replies;
+    bool written = false;
+    auto result = OutputQueue::FlushResult::Drained;
+    while (!out.empty()) {
+        iovec iov[OutputQueue::MAX_IOV];
+        int count = out.prepareIov(iov, OutputQueue::MAX_IOV);
+        size_t total = 0;
+        bool full = false;
+        for (int i = 0; i < count && !full; ++i) {
+            size_t n = ring.write(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+            if (n == ShmRing::CORRUPT) {
+                Logger::log(corruptLog, Logger::Level::Warn, "Shared memory reply ring corrupted by client");
+                return OutputQueue::FlushResult::Error;
+            }
+            total += n;
+            full = n < iov[i].iov_len;
+        }
+        out.consume(total);
+        written = written || total > 0;
+        if (full && !ring.markWaiting()) {
+            result = OutputQueue::FlushResult::Blocked;
+            break;
+        }
+    }
+    if (written) signal(replyFd_);
+    return result;
+}
+
+void ShmChannel::signal(int fd) {
+    uint64_t one = 1;
+    // EAGAIN - счетчик переполнен, пробуждение и так ждет читателя
+    [[maybe_unused]] ssize_t n = write(fd, &one, sizeof(one));
+}
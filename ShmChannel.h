@@ -0,0 +1,37 @@
+#pragma once
+#include <sys/types.h>
+#include <cstddef>
+#include <memory>
+#include "InputBuffer.h"
+#include "OutputQueue.h"
+#include "ShmRing.h"
+
+/**
+ * Серверная сторона сеанса /shm: кольца запросов и ответов в memfd и два eventfd
+ * Клиент на той же машине получает их через Unix сокет и обменивается данными без
+ * сетевого стека: запись в кольцо и один write в eventfd на пачку сообщений
+ */
+class ShmChannel {
+public:
+    ~ShmChannel();
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    static std::unique_ptr<ShmChannel> create();
+
+    bool sendTo(int socketFd, const char* text, size_t len);
+    ssize_t receive(InputBuffer& in, size_t hint);
+    OutputQueue::FlushResult flush(OutputQueue& out);
+
+    /// eventfd, в который клиент пишет после новых запросов или освобождения места под ответы
+    int requestFd() const { return requestFd_; }
+
+private:
+    ShmChannel() = default;
+    static void signal(int fd);
+
+    ShmLayout* layout_ = nullptr;
+    int memFd_ = -1;            ///< Нужен только до передачи клиенту
+    int requestFd_ = -1;        ///< Будит сервер
+    int replyFd_ = -1;          ///< Будит клиента
+};
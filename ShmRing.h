@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Кольцо байт одного писателя и одного читателя в разделяемой памяти (транспорт /shm)
+ * head двигает только писатель, tail - только читатель; индексы растут монотонно,
+ * позиция в data - индекс по модулю CAPACITY. Индексы разнесены по строкам кэша,
+ * чтобы писатель и читатель на разных ядрах не делили одну строку.
+ * Индексы лежат в памяти, доступной другой стороне, поэтому каждое обращение
+ * проверяет их согласованность: испорченное кольцо не выводит копирование за data
+ */
+struct ShmRing {
+    static constexpr size_t CAPACITY = 64 * 1024;    ///< Степень двойки
+
+    alignas(64) std::atomic<uint64_t> head{0};       ///< Записано байт (писатель)
+    alignas(64) std::atomic<uint64_t> tail{0};       ///< Прочитано байт (читатель)
+    std::atomic<uint32_t> writerWaiting{0};          ///< Писатель ждет места и должен быть разбужен
+    alignas(64) char data[CAPACITY];
+
+    static constexpr size_t CORRUPT = SIZE_MAX;       ///< Результат read/write при испорченных индексах
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+
+    /// Заполнено не больше CAPACITY; tail впереди head дает огромную разность и тоже отвергается
+    static bool consistent(uint64_t h, uint64_t t) { return h - t <= CAPACITY; }
+
+    /**
+     * Запись сколько поместится
+     * @param src Данные
+     * @param len Длина
+     * @return Записано байт (меньше len, если кольцо заполнилось) или CORRUPT
+     */
+    size_t write(const char* src, size_t len) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        if (!consistent(h, t)) return CORRUPT;
+        size_t n = len < CAPACITY - (h - t) ? len : static_cast<size_t>(CAPACITY - (h - t));
+        size_t pos = static_cast<size_t>(h) & (CAPACITY - 1);
+        size_t first = n < CAPACITY - pos ? n : CAPACITY - pos;
+        std::memcpy(data + pos, src, first);
+        std::memcpy(data, src + first, n - first);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Чтение сколько есть
+     * @param dst Буфер
+     * @param len Размер буфера
+     * @return Прочитано байт (не больше CAPACITY) или CORRUPT
+     */
+    size_t read(char* dst, size_t len) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        if (!consistent(h, t)) return CORRUPT;
+        size_t n = len < h - t ? len : static_cast<size_t>(h - t);
+        size_t pos = static_cast<size_t>(t) & (CAPACITY - 1);
+        size_t first = n < CAPACITY - pos ? n : CAPACITY - pos;
+        std::memcpy(dst, data + pos, first);
+        std::memcpy(dst + first, data, n - first);
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t readable() const {
+        return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Писатель: кольцо заполнено, просим читателя разбудить нас после чтения
+     * Флаг и tail проверяются крест-накрест с takeWaiting, поэтому пробуждение не теряется
+     * @return true, если место уже появилось и можно писать дальше
+     */
+    bool markWaiting() {
+        writerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed) < CAPACITY;
+    }
+
+    /**
+     * Читатель: после чтения проверить, ждет ли писатель места
+     * @return true, если писателя нужно разбудить
+     */
+    bool takeWaiting() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return writerWaiting.load(std::memory_order_relaxed) != 0 &&
+               writerWaiting.exchange(0, std::memory_order_relaxed) != 0;
+    }
+};
+
+/**
+ * Разделяемая область сеанса /shm: memfd, который сервер передает клиенту
+ * Клиент пишет запросы в requests и будит сервер через первый eventfd,
+ * сервер пишет ответы в replies и будит клиента через второй. Поток байт в кольцах -
+ * тот же текстовый (или после /binary - двоичный) протокол, что и в сокете
+ */
+struct ShmLayout {
+    static constexpr uint32_t MAGIC = 0x54545352;    ///< "TTSR"
+
+    uint32_t magic = MAGIC;
+    uint32_t capacity = ShmRing::CAPACITY;
+    ShmRing requests;                                ///< Клиент -> сервер
+    ShmRing replies;                                 ///< Сервер -> клиент
+};
@@ -0,0 +1,171 @@
+#include "SourceLimiter.h"
+#include <chrono>
+
+/**
+ * Конструктор ограничителя
+ * @param rate Событий в секунду на адрес (0 - ограничение выключено)
+ * @param burst Емкость корзины (меньше 1 - равна rate, но не меньше 1)
+ * @param maxSources Предел отслеживаемых адресов
+ */
+SourceLimiter::SourceLimiter(double rate, double burst, size_t maxSources) :
+    rate_(rate),
+    burst_(burst >= 1 ? burst : (rate >= 1 ? rate : 1)),
+    maxPerShard_((maxSources + SHARDS - 1) / SHARDS),
+    maxCapacity_(MIN_CAPACITY) {
+    if (!enabled()) return;
+    while (maxCapacity_ / 4 * 3 < maxPerShard_) maxCapacity_ <<= 1;
+    shards_ = std::make_unique<Shard[]>(SHARDS);
+    for (size_t i = 0; i < SHARDS; ++i) shards_[i].slots.resize(MIN_CAPACITY);
+}
+
+/**
+ * Перемешивание адреса (финализатор MurmurHash3)
+ */
+uint64_t SourceLimiter::hash(uint32_t addr) {
+    uint64_t key = addr;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+uint64_t SourceLimiter::nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Наполнение корзины к моменту now
+ * @return Количество жетонов, не больше burst
+ */
+float SourceLimiter::refill(const Slot& slot, uint64_t now) const {
+    double tokens = slot.tokens + static_cast<double>(now - slot.updatedMs) * rate_ / 1000.0;
+    return static_cast<float>(tokens < burst_ ? tokens : burst_);
+}
+
+/**
+ * Проверка и списание жетона
+ * @param addr IPv4 адрес источника (в любом порядке байт, но одинаковом для всех вызовов)
+ * @return true, если событие укладывается в лимит адреса
+ */
+bool SourceLimiter::allow(uint32_t addr) {
+    if (!enabled()) return true;
+
+    uint64_t h = hash(addr);
+    Shard& s = shards_[h >> 60];
+    uint64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    size_t mask = s.slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        Slot& slot = s.slots[i];
+        if (slot.addr == addr) {
+            float tokens = refill(slot, now);
+            slot.updatedMs = now;
+            if (tokens < 1.0f) {
+                slot.tokens = tokens;
+                return false;
+            }
+            slot.tokens = tokens - 1.0f;
+            return true;
+        }
+        if (slot.addr == 0) break;
+    }
+
+    // Новый адрес: попутно вычищаем несколько полных корзин; при заполнении таблицы растем,
+    // на пределе - проверяем больше ячеек, а если места так и нет, вытесняем самую давнюю
+    sweep(s, SWEEP_STEP, now);
+    if (full(s, maxPerShard_) && s.slots.size() < maxCapacity_) grow(s, now);
+    if (full(s, maxPerShard_)) {
+        size_t stalest = sweep(s, FULL_SWEEP_STEP, now);
+        if (full(s, maxPerShard_)) {
+            // Без записи адрес нельзя проверить - такое событие не пропускается
+            if (stalest == NONE) return false;
+            erase(s, stalest);
+        }
+    }
+    mask = s.slots.size() - 1;
+
+    size_t i = h & mask;
+    while (s.slots[i].addr != 0) i = (i + 1) & mask;
+    s.slots[i] = Slot{addr, static_cast<float>(burst_ - 1.0), now};
+    s.used++;
+    return true;
+}
+
+/**
+ * Нет места для нового адреса: заполнение выше 3/4 или предел записей шарда
+ */
+bool SourceLimiter::full(const Shard& s, size_t maxPerShard) {
+    return (s.used + 1) * 4 > s.slots.size() * 3 || s.used >= maxPerShard;
+}
+
+/**
+ * Постепенная очистка: проверка следующих steps ячеек, начиная с sweepPos, и удаление полных корзин
+ * Вызывается под блокировкой шарда
+ * @param s Шард
+ * @param steps Сколько ячеек проверить
+ * @param now Текущее время, мс
+ * @return Ячейка самой давней из оставшихся просмотренных записей или NONE, если очистка
+ *         что-то удалила (после удаления записи сдвигаются, и номер ячейки устаревает)
+ */
+size_t SourceLimiter::sweep(Shard& s, size_t steps, uint64_t now) const {
+    size_t mask = s.slots.size() - 1;
+    size_t stalest = NONE;
+    bool erased = false;
+    if (steps > s.slots.size()) steps = s.slots.size();
+    for (size_t n = 0; n < steps && s.used > 0; ++n) {
+        size_t i = s.sweepPos & mask;
+        const Slot& slot = s.slots[i];
+        // После удаления в ячейку может сдвинуться следующая запись - ее проверяем на следующем шаге
+        if (slot.addr != 0 && refill(slot, now) >= burst_) {
+            erase(s, i);
+            erased = true;
+            continue;
+        }
+        if (slot.addr != 0 && (stalest == NONE || slot.updatedMs < s.slots[stalest].updatedMs)) stalest = i;
+        s.sweepPos = i + 1;
+    }
+    return erased ? NONE : stalest;
+}
+
+/**
+ * Удаление записи со сдвигом следующих записей цепочки назад (без надгробий)
+ * @param s Шард
+ * @param i Ячейка удаляемой записи
+ */
+void SourceLimiter::erase(Shard& s, size_t i) {
+    size_t mask = s.slots.size() - 1;
+    for (size_t j = (i + 1) & mask; s.slots[j].addr != 0; j = (j + 1) & mask) {
+        // Запись из j можно перенести в i, если ее домашняя ячейка не лежит в (i, j]
+        size_t home = hash(s.slots[j].addr) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            s.slots[i] = s.slots[j];
+            i = j;
+        }
+    }
+    s.slots[i] = Slot{};
+    s.used--;
+}
+
+/**
+ * Удвоение таблицы шарда без полных корзин
+ * Вызывается под блокировкой шарда; за время жизни шарда происходит не больше
+ * log2(maxCapacity_ / MIN_CAPACITY) раз
+ */
+void SourceLimiter::grow(Shard& s, uint64_t now) {
+    std::vector<Slot> old(s.slots.size() * 2);
+    old.swap(s.slots);
+    s.used = 0;
+
+    size_t mask = s.slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.addr == 0 || refill(slot, now) >= burst_) continue;
+        size_t i = hash(slot.addr) & mask;
+        while (s.slots[i].addr != 0) i = (i + 1) & mask;
+        s.slots[i] = slot;
+        s.used++;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Ограничение частоты событий от одного IPv4 адреса (token bucket)
+ * Корзины хранятся в шардированных таблицах с открытой адресацией по 16 байт на адрес.
+ * Запись с полной корзиной ничем не отличается от отсутствующей, поэтому такие записи
+ * вычищаются понемногу при добавлении адресов. Если таблица заполнена и очистка не освободила
+ * места, вытесняется самая давняя из просмотренных записей: новый адрес всегда получает
+ * корзину, а ограничение по адресам не превращается в отказ для всех
+ */
+class SourceLimiter {
+public:
+    SourceLimiter(double rate, double burst, size_t maxSources);
+
+    bool enabled() const { return rate_ > 0; }
+    bool allow(uint32_t addr);
+
+private:
+    static constexpr size_t SHARDS = 16;
+    static constexpr size_t MIN_CAPACITY = 64;
+    static constexpr size_t SWEEP_STEP = 16;            ///< Ячеек, проверяемых при добавлении адреса
+    static constexpr size_t FULL_SWEEP_STEP = 64;       ///< Ячеек, проверяемых при заполненной таблице
+    static constexpr size_t NONE = ~size_t{0};
+
+    /// Корзина адреса; адрес 0 (INADDR_ANY) не может быть источником и обозначает пустую ячейку
+    struct Slot {
+        uint32_t addr = 0;
+        float tokens = 0;
+        uint64_t updatedMs = 0;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        size_t used = 0;
+        size_t sweepPos = 0;        ///< Следующая ячейка постепенной очистки
+    };
+
+    static uint64_t hash(uint32_t addr);
+    static uint64_t nowMs();
+
+    float refill(const Slot& slot, uint64_t now) const;
+    static bool full(const Shard& s, size_t maxPerShard);
+    size_t sweep(Shard& s, size_t steps, uint64_t now) const;
+    static void erase(Shard& s, size_t i);
+    void grow(Shard& s, uint64_t now);
+
+    double rate_;
+    double burst_;
+    size_t maxPerShard_;
+    size_t maxCapacity_;
+    std::unique_ptr<Shard[]> shards_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Задача для пула потоков без выделения памяти
+ * Замыкание хранится во встроенном буфере (small buffer optimization);
+ * на куче размещаются только замыкания, которые в буфер не помещаются
+ */
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 48;   ///< Размер встроенного буфера под замыкание
+
+    Task() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (fitsInline<Fn>()) {
+            new (storage_) Fn(std::forward<F>(f));
+            ops_ = &inlineOps<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+            ops_ = &heapOps<Fn>;
+        }
+    }
+
+    Task(Task&& other) noexcept { moveFrom(other); }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    /// Время постановки в очередь (нс), для метрики ожидания в пуле
+    void stamp(uint64_t ns) { enqueuedAt_ = ns; }
+    uint64_t enqueuedAt() const { return enqueuedAt_; }
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    /// Помещается ли замыкание типа F во встроенный буфер
+    template <typename F>
+    static constexpr bool fitsInline() {
+        return sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+private:
+    /// Таблица операций над хранимым замыканием
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template <typename F>
+    static constexpr Ops inlineOps = {
+        [](void* s) { (*static_cast<F*>(s))(); },
+        [](void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        },
+        [](void* s) { static_cast<F*>(s)->~F(); },
+    };
+
+    template <typename F>
+    static constexpr Ops heapOps = {
+        [](void* s) { (**static_cast<F**>(s))(); },
+        [](void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+        [](void* s) { delete *static_cast<F**>(s); },
+    };
+
+    void moveFrom(Task& other) {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+        enqueuedAt_ = other.enqueuedAt_;
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops* ops_ = nullptr;
+    uint64_t enqueuedAt_ = 0;
+};
@@ -1,63 +1,226 @@
 #include "ThreadPool.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Utils.h"
+
+namespace {
+/// Пул и индекс текущего рабочего потока (для постановки задач в свою же очередь)
+thread_local const void* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+}
 
 /**
  * Конструктор пула потоков
  * @param threads количество рабочих потоков для создания
+ * @param spinNs время опроса очередей перед засыпанием, нс (0 - без опроса)
+ * @param cpus ядра для потоков по кругу (пусто - не закреплять)
  */
-ThreadPool::ThreadPool(size_t threads) : stop_(false) {
-    // Создаем указанное количество рабочих потоков
+ThreadPool::ThreadPool(size_t threads, uint64_t spinNs, std::vector<int> cpus) : stop_(false), spinNs_(spinNs) {
+    // Сначала создаем все очереди, чтобы потоки могли сразу перехватывать задачи у соседей
+    for (size_t i = 0; i < threads; ++i)
+        workers_.push_back(std::make_unique<Worker>());
     for (size_t i = 0; i < threads; ++i) {
-        workers_.emplace_back([this] {
-            // Бесконечный цикл выполнения задач
-            while (true) {
-                std::function<void()> task;
-
-                {
-                    // Блокируем мьютекс для безопасного доступа к очереди задач
-                    std::unique_lock<std::mutex> lock(queueMutex_);
-
-                    // Ожидаем появления задачи или сигнала остановки
-                    condition_.wait(lock, [this]{
-                        return stop_ || !tasks_.empty();
-                    });
-
-                    // Если пул остановлен и задач нет - завершаем поток
-                    if (stop_ && tasks_.empty()) return;
-
-                    // Извлекаем задачу из очереди
-                    task = std::move(tasks_.front());
-                    tasks_.pop();
-                }
-
-                // Выполняем задачу вне критической секции
-                task();
-            }
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        workers_[i]->thread = std::thread([this, i, cpu] {
+            if (cpu >= 0) pinThread(cpu);
+            workerLoop(i);
         });
     }
 }
 
+/**
+ * Цикл рабочего потока
+ * Нет работы - опрос очередей (если задан spinNs), затем сон до пробуждения
+ * @param index номер потока
+ */
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    Worker& w = *workers_[index];
+
+    while (true) {
+        Task task;
+        if (findTask(index, task) || (spinNs_ > 0 && spinForTask(index, task))) {
+            // Выполняем задачу без каких-либо блокировок
+            uint64_t waited = Metrics::nowNs() - task.enqueuedAt();
+            Metrics::record(Metrics::Histogram::QueueWait, waited);
+            FlightRecorder::record(FlightRecorder::Event::Dequeue, -1, waited / 1000);
+            task();
+            FlightRecorder::record(FlightRecorder::Event::TaskDone);
+            continue;
+        }
+
+        // Если пул остановлен и задач нет - завершаем поток
+        if (stop_) return;
+
+        park(w);
+    }
+}
+
+/**
+ * Поиск задачи: свои закрепленные задачи, своя общая очередь, очереди соседей
+ * @param index номер потока
+ * @param task [out] найденная задача
+ * @return true, если задача найдена
+ */
+bool ThreadPool::findTask(size_t index, Task& task) {
+    Worker& w = *workers_[index];
+    return w.pinned.tryPop(task) || w.shared.tryPop(task) || trySteal(index, task);
+}
+
+/**
+ * Опрос очередей перед засыпанием (режим низкой задержки)
+ * Поток не помечен спящим, поэтому производитель не делает системный вызов пробуждения
+ * @param index номер потока
+ * @param task [out] найденная задача
+ * @return true, если задача появилась за время опроса
+ */
+bool ThreadPool::spinForTask(size_t index, Task& task) {
+    uint64_t deadline = Metrics::nowNs() + spinNs_;
+    do {
+        for (int i = 0; i < 64; ++i) cpuRelax();
+        if (findTask(index, task)) return true;
+    } while (!stop_ && Metrics::nowNs() < deadline);
+    return false;
+}
+
+/**
+ * Перехват задачи из общей очереди другого потока
+ * @param thief номер потока, который ищет работу
+ * @param task [out] перехваченная задача
+ * @return true, если задача найдена
+ */
+bool ThreadPool::trySteal(size_t thief, Task& task) {
+    const size_t n = workers_.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker& victim = *workers_[(thief + k) % n];
+        if (victim.shared.tryPop(task)) return true;
+    }
+    return false;
+}
+
+/**
+ * Засыпание потока до появления работы
+ * Флаг sleeping выставляется до повторной проверки очередей, поэтому
+ * производитель либо увидит флаг и разбудит поток, либо поток увидит задачу
+ * @param w состояние текущего потока
+ */
+void ThreadPool::park(Worker& w) {
+    std::unique_lock<std::mutex> lock(w.parkMutex);
+    w.sleeping.store(true, std::memory_order_seq_cst);
+    w.parkCv.wait(lock, [this, &w] {
+        return stop_ || w.signaled || !w.pinned.empty() || !w.shared.empty();
+    });
+    w.signaled = false;
+    w.sleeping.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * Пробуждение потока, если он спит
+ * @param w состояние потока
+ */
+void ThreadPool::wake(Worker& w) {
+    if (w.sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(w.parkMutex);
+        w.signaled = true;
+        w.parkCv.notify_one();
+    }
+}
+
+/**
+ * Пробуждение одного спящего потока, чтобы он перехватил задачу у занятого соседа
+ * @param except поток, в очередь которого положена задача
+ */
+void ThreadPool::wakeIdle(size_t except) {
+    const size_t n = workers_.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker& w = *workers_[(except + k) % n];
+        if (w.sleeping.load(std::memory_order_seq_cst)) {
+            wake(w);
+            return;
+        }
+    }
+}
+
 /**
  * Добавление задачи в очередь на выполнение
+ * Задача может быть выполнена любым потоком
  * @param task функция для выполнения в одном из рабочих потоков
  */
-void ThreadPool::enqueue(std::function<void()> task) {
-    {
-        // Блокируем мьютекс для безопасного добавления в очередь
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        tasks_.push(std::move(task));
+void ThreadPool::enqueue(Task task) {
+    const size_t n = workers_.size();
+    // Пул без потоков (режим реакторов) - выполняем на месте
+    if (n == 0) {
+        task();
+        return;
+    }
+
+    task.stamp(Metrics::nowNs());
+    FlightRecorder::record(FlightRecorder::Event::Enqueue);
+
+    // Из рабочего потока кладем в свою очередь, извне - по кругу
+    size_t target = currentPool == this ? currentIndex
+                                        : nextWorker_.fetch_add(1, std::memory_order_relaxed) % n;
+    while (true) {
+        for (size_t k = 0; k < n; ++k) {
+            size_t i = (target + k) % n;
+            Worker& w = *workers_[i];
+            if (w.shared.tryPush(task)) {
+                if (w.sleeping.load(std::memory_order_seq_cst)) wake(w);
+                else wakeIdle(i);
+                return;
+            }
+        }
+        // Все очереди заполнены - уступаем процессор рабочим потокам
+        std::this_thread::yield();
     }
-    // Уведомляем один из ожидающих потоков о новой задаче
-    condition_.notify_one();
+}
+
+/**
+ * Добавление задачи, закрепленной за ключом
+ * Все задачи с одинаковым ключом выполняются одним потоком в порядке добавления
+ * @param key ключ привязки (например, файловый дескриптор соединения)
+ * @param task функция для выполнения
+ */
+void ThreadPool::enqueueFor(size_t key, Task task) {
+    const size_t n = workers_.size();
+    if (n == 0) {
+        task();
+        return;
+    }
+
+    task.stamp(Metrics::nowNs());
+    FlightRecorder::record(FlightRecorder::Event::Enqueue, static_cast<int>(key));
+    Worker& w = *workers_[key % n];
+    while (!w.pinned.tryPush(task)) {
+        wake(w);
+        std::this_thread::yield();
+    }
+    wake(w);
+}
+
+/**
+ * Количество задач, ожидающих выполнения во всех очередях (приблизительно)
+ * Читает только индексы очередей и не мешает производителям и потокам пула
+ */
+size_t ThreadPool::queued() const {
+    size_t total = 0;
+    for (auto& w : workers_) total += w->pinned.size() + w->shared.size();
+    return total;
 }
 
 /**
  * Деструктор пула потоков - останавливает все потоки
+ * Потоки дорабатывают оставшиеся задачи и завершаются
  */
 ThreadPool::~ThreadPool() {
     // Устанавливаем флаг остановки
     stop_ = true;
     // Уведомляем все потоки о необходимости завершения
-    condition_.notify_all();
+    for (auto& w : workers_) {
+        std::lock_guard<std::mutex> lock(w->parkMutex);
+        w->parkCv.notify_all();
+    }
     // Ожидаем завершения всех рабочих потоков
-    for (auto &w : workers_) w.join();
-}
\ No newline at end of file
+    for (auto& w : workers_) w->thread.join();
+}
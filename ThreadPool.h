@@ -1,23 +1,55 @@
 #pragma once
 #include <thread>
 #include <vector>
-#include <queue>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
 #include <atomic>
+#include <cstdint>
+#include "MpmcQueue.h"
+#include "Task.h"
 
+/**
+ * Пул потоков с очередями на каждый поток и перехватом работы (work stealing)
+ * enqueue кладет задачу в общую очередь одного из потоков, откуда ее могут забрать
+ * простаивающие соседи; enqueueFor закрепляет все задачи одного ключа (например, fd)
+ * за одним потоком, сохраняя их порядок
+ */
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t threads);
+    explicit ThreadPool(size_t threads, uint64_t spinNs = 0, std::vector<int> cpus = {});
     ~ThreadPool();
 
-    void enqueue(std::function<void()> task);
+    void enqueue(Task task);
+    void enqueueFor(size_t key, Task task);
+
+    size_t size() const { return workers_.size(); }
+    size_t queued() const;
 
 private:
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    std::mutex queueMutex_;
-    std::condition_variable condition_;
+    static constexpr size_t QUEUE_CAPACITY = 1024;   ///< Емкость каждой очереди потока
+
+    /// Состояние рабочего потока
+    struct Worker {
+        MpmcQueue<Task> pinned{QUEUE_CAPACITY};   ///< Закрепленные задачи (только этот поток)
+        MpmcQueue<Task> shared{QUEUE_CAPACITY};   ///< Задачи, которые можно перехватить
+        std::mutex parkMutex;
+        std::condition_variable parkCv;
+        std::atomic<bool> sleeping{false};
+        bool signaled = false;                    ///< Поток разбужен явно (защищено parkMutex)
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+    bool findTask(size_t index, Task& task);
+    bool spinForTask(size_t index, Task& task);
+    bool trySteal(size_t thief, Task& task);
+    void park(Worker& w);
+    void wake(Worker& w);
+    void wakeIdle(size_t except);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> nextWorker_{0};
     std::atomic<bool> stop_;
+    uint64_t spinNs_;                             ///< Опрос очередей перед засыпанием, нс (0 - сразу спать)
 };
@@ -0,0 +1,75 @@
+#include "TimerWheel.h"
+
+/**
+ * Конструктор колеса
+ * @param nowMs Текущее время, мс
+ */
+TimerWheel::TimerWheel(uint64_t nowMs) :
+    current_(nowMs / TICK_MS) {
+    for (auto& level : slots_)
+        for (Node& head : level) head.prev = head.next = &head;
+}
+
+/**
+ * Постановка или перестановка таймера
+ * Сроки в прошлом срабатывают на следующем тике
+ * @param node Узел таймера
+ * @param deadlineMs Срок, мс (в той же шкале, что и advance)
+ */
+void TimerWheel::schedule(Node& node, uint64_t deadlineMs) {
+    if (node.scheduled()) cancel(node);
+    uint64_t tick = (deadlineMs + TICK_MS - 1) / TICK_MS;
+    node.expires = tick > current_ ? tick : current_ + 1;
+    place(node);
+    ++size_;
+}
+
+/**
+ * Снятие таймера; для неактивного узла ничего не делает
+ */
+void TimerWheel::cancel(Node& node) {
+    if (!node.scheduled()) return;
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+    --size_;
+}
+
+/**
+ * Вставка узла в ячейку уровня, соответствующего оставшемуся времени
+ */
+void TimerWheel::place(Node& node) {
+    uint64_t delta = node.expires - current_;
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) ++level;
+
+    // За горизонтом колеса: ставим в самую дальнюю ячейку, при каскаде узел опустится ниже
+    uint64_t horizon = uint64_t{1} << (SLOT_BITS * LEVELS);
+    uint64_t expires = delta < horizon ? node.expires : current_ + horizon - 1;
+
+    Node& head = slots_[level][(expires >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    node.next = &head;
+    node.prev = head.prev;
+    head.prev->next = &node;
+    head.prev = &node;
+}
+
+/**
+ * Перенос узлов старших уровней, чья ячейка наступила, на младшие уровни
+ * Выполняется, когда младшие разряды текущего тика обнуляются
+ */
+void TimerWheel::cascade() {
+    for (unsigned level = 1; level < LEVELS; ++level) {
+        uint64_t mask = (uint64_t{1} << (SLOT_BITS * level)) - 1;
+        if (current_ & mask) break;
+
+        Node& head = slots_[level][(current_ >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        Node* node = head.next;
+        head.prev = head.next = &head;
+        while (node != &head) {
+            Node* next = node->next;
+            place(*node);
+            node = next;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Иерархическое колесо таймеров
+ * Четыре уровня по 64 ячейки с шагом TICK_MS покрывают ~19 суток; более далекие сроки
+ * ограничиваются горизонтом колеса. Узлы встраиваются в объекты-владельцы, поэтому
+ * постановка, перестановка и отмена - O(1) без выделения памяти.
+ * Колесо не потокобезопасно: синхронизацию обеспечивает владелец
+ */
+class TimerWheel {
+public:
+    static constexpr uint64_t TICK_MS = 100;        ///< Шаг колеса, мс
+
+    /// Узел таймера, встраиваемый в объект-владелец
+    struct Node {
+        Node* prev = nullptr;
+        Node* next = nullptr;
+        uint64_t expires = 0;       ///< Срок в тиках
+        uint64_t data = 0;          ///< Данные владельца (например, идентификатор соединения)
+
+        bool scheduled() const { return next != nullptr; }
+    };
+
+    explicit TimerWheel(uint64_t nowMs = monotonicMs());
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    void schedule(Node& node, uint64_t deadlineMs);
+    void cancel(Node& node);
+    size_t size() const { return size_; }
+
+    /**
+     * Продвижение колеса до текущего времени
+     * @param nowMs Текущее время, мс
+     * @param expired Вызывается для каждого истекшего узла (узел уже снят с колеса
+     *                и может быть поставлен заново)
+     */
+    template <typename Fn>
+    void advance(uint64_t nowMs, Fn&& expired) {
+        uint64_t target = nowMs / TICK_MS;
+        if (size_ == 0) {
+            if (target > current_) current_ = target;
+            return;
+        }
+        while (current_ < target) {
+            ++current_;
+            cascade();
+            Node& head = slots_[0][current_ & (SLOTS - 1)];
+            while (head.next != &head) {
+                Node& node = *head.next;
+                cancel(node);
+                expired(node);
+            }
+        }
+    }
+
+    /// Монотонное время в миллисекундах
+    static uint64_t monotonicMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+
+    void place(Node& node);
+    void cascade();
+
+    Node slots_[LEVELS][SLOTS];     ///< Заголовки кольцевых списков ячеек
+    uint64_t current_;              ///< Текущий тик
+    size_t size_ = 0;               ///< Поставленных узлов
+};
@@ -0,0 +1,183 @@
+#include "UdpBatch.h"
+#include <netinet/udp.h>
+#include <cerrno>
+#include <cstring>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+/**
+ * Подготовка заголовков recvmmsg (указатели на буферы не меняются между пачками)
+ */
+UdpBatch::UdpBatch() {
+    for (unsigned i = 0; i < BATCH; ++i) {
+        recvIov_[i].iov_base = buffers_[i];
+        recvIov_[i].iov_len = DATAGRAM_SIZE;
+    }
+}
+
+/**
+ * Прием пачки датаграмм
+ * @param fd UDP сокет (неблокирующий, с включенным SO_RXQ_OVFL)
+ * @return Количество принятых датаграмм, 0 если очередь пуста, -1 при ошибке
+ */
+int UdpBatch::receive(int fd) {
+    for (unsigned i = 0; i < BATCH; ++i) {
+        msghdr& h = recvMsgs_[i].msg_hdr;
+        h = msghdr{};
+        h.msg_name = &peers_[i];
+        h.msg_namelen = sizeof(peers_[i]);
+        h.msg_iov = &recvIov_[i];
+        h.msg_iovlen = 1;
+        h.msg_control = recvControl_[i];
+        h.msg_controllen = CONTROL_SIZE;
+        recvMsgs_[i].msg_len = 0;
+    }
+    queuedCount_ = 0;
+
+    int n = recvmmsg(fd, recvMsgs_, BATCH, MSG_DONTWAIT, nullptr);
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+    // Счетчик отброшенных ядром датаграмм приходит с каждым сообщением; берем последний
+    for (int i = n - 1; i >= 0; --i) {
+        msghdr& h = recvMsgs_[i].msg_hdr;
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&h); cm; cm = CMSG_NXTHDR(&h, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t overflow;
+                std::memcpy(&overflow, CMSG_DATA(cm), sizeof(overflow));
+                drops_ += overflow - lastOverflow_;
+                lastOverflow_ = overflow;
+                return n;
+            }
+        }
+    }
+    return n;
+}
+
+/**
+ * Содержимое i-й принятой датаграммы
+ */
+std::string_view UdpBatch::datagram(unsigned i) const {
+    return {buffers_[i], recvMsgs_[i].msg_len};
+}
+
+/**
+ * Количество датаграмм, отброшенных ядром (переполнение буфера сокета) с прошлого вызова
+ */
+uint32_t UdpBatch::takeKernelDrops() {
+    uint32_t drops = drops_;
+    drops_ = 0;
+    return drops;
+}
+
+/**
+ * Отметка ответа на i-ю датаграмму к отправке
+ * @param i Номер датаграммы в пачке (ответ лежит в reply(i))
+ */
+void UdpBatch::queueReply(unsigned i) {
+    queued_[queuedCount_++] = i;
+}
+
+/**
+ * Формирование сообщений sendmmsg из очереди ответов
+ * При GSO подряд идущие ответы одному пиру одинакового размера (последний может
+ * быть короче) объединяются в одно сообщение; ядро само нарежет его на датаграммы
+ * @param gso Разрешено ли объединение
+ * @return Количество сообщений
+ */
+size_t UdpBatch::buildMessages(bool gso) {
+    size_t msgs = 0;
+    unsigned k = 0;
+    while (k < queuedCount_) {
+        unsigned first = queued_[k];
+        const std::string& head = replies_[first];
+        unsigned segments = 1;
+        size_t bytes = head.size();
+
+        if (gso && !head.empty() && head.size() <= MAX_GSO_SEGMENT) {
+            while (k + segments < queuedCount_ && segments < MAX_GSO_SEGMENTS) {
+                unsigned next = queued_[k + segments];
+                const std::string& r = replies_[next];
+                const sockaddr_in& a = peers_[first];
+                const sockaddr_in& b = peers_[next];
+                if (a.sin_addr.s_addr != b.sin_addr.s_addr || a.sin_port != b.sin_port) break;
+                if (r.empty() || r.size() > head.size() || bytes + r.size() > MAX_GSO_BYTES) break;
+                // Короче первого может быть только последний сегмент
+                if (replies_[queued_[k + segments - 1]].size() != head.size()) break;
+                bytes += r.size();
+                ++segments;
+            }
+        }
+
+        for (unsigned s = 0; s < segments; ++s) {
+            const std::string& r = replies_[queued_[k + s]];
+            sendIov_[k + s].iov_base = const_cast<char*>(r.data());
+            sendIov_[k + s].iov_len = r.size();
+        }
+
+        msghdr& h = sendMsgs_[msgs].msg_hdr;
+        h = msghdr{};
+        h.msg_name = &peers_[first];
+        h.msg_namelen = sizeof(peers_[first]);
+        h.msg_iov = &sendIov_[k];
+        h.msg_iovlen = segments;
+        if (segments > 1) {
+            h.msg_control = sendControl_[msgs];
+            h.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cmsghdr* cm = CMSG_FIRSTHDR(&h);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            auto segmentSize = static_cast<uint16_t>(head.size());
+            std::memcpy(CMSG_DATA(cm), &segmentSize, sizeof(segmentSize));
+        }
+        sendSegments_[msgs] = segments;
+        ++msgs;
+        k += segments;
+    }
+    return msgs;
+}
+
+/**
+ * Отправка всех ответов пачки одним sendmmsg
+ * @param fd UDP сокет
+ * @param gso [in/out] Использовать UDP GSO; сбрасывается, если ядро или сетевая карта его не поддерживают
+ * @return Количество датаграмм, которые не удалось отправить
+ */
+size_t UdpBatch::sendReplies(int fd, bool& gso) {
+    size_t msgs = buildMessages(gso);
+    size_t sent = 0;
+    size_t dropped = 0;
+
+    while (sent < msgs) {
+        int n = sendmmsg(fd, sendMsgs_ + sent, static_cast<unsigned>(msgs - sent), MSG_DONTWAIT);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && sendSegments_[sent] > 1 && (errno == EIO || errno == EINVAL)) {
+            // GSO недоступен: отключаем и пересобираем оставшиеся ответы без него
+            gso = false;
+            unsigned done = 0;
+            for (size_t m = 0; m < sent; ++m) done += sendSegments_[m];
+            std::memmove(queued_, queued_ + done, (queuedCount_ - done) * sizeof(unsigned));
+            queuedCount_ -= done;
+            msgs = buildMessages(false);
+            sent = 0;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            // Ошибка относится к одному получателю - пропускаем его сообщение
+            dropped += sendSegments_[sent++];
+            continue;
+        }
+        // Буфер сокета заполнен - остаток ответов теряется
+        for (size_t m = sent; m < msgs; ++m) dropped += sendSegments_[m];
+        break;
+    }
+
+    queuedCount_ = 0;
+    return dropped;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/**
+ * Пакетный прием и отправка UDP датаграмм (recvmmsg/sendmmsg)
+ * Одна пачка - до BATCH датаграмм за системный вызов. Ответы одному пиру
+ * одинакового размера при включенном GSO склеиваются в один sendmsg с UDP_SEGMENT
+ */
+class UdpBatch {
+public:
+    static constexpr unsigned BATCH = 64;            ///< Датаграмм за один recvmmsg
+    static constexpr size_t DATAGRAM_SIZE = 2048;    ///< Максимальный размер датаграммы
+
+    UdpBatch();
+
+    int receive(int fd);
+    std::string_view datagram(unsigned i) const;
+    const sockaddr_in& peer(unsigned i) const { return peers_[i]; }
+    uint32_t takeKernelDrops();
+
+    /// Буфер ответа на i-ю датаграмму (емкость переиспользуется между пачками)
+    std::string& reply(unsigned i) { return replies_[i]; }
+    void queueReply(unsigned i);
+    size_t sendReplies(int fd, bool& gso);
+    unsigned queuedReplies() const { return queuedCount_; }
+
+private:
+    static constexpr size_t CONTROL_SIZE = 64;      ///< Место под cmsg (SO_RXQ_OVFL / UDP_SEGMENT)
+    static constexpr unsigned MAX_GSO_SEGMENTS = 64;    ///< Предел ядра UDP_MAX_SEGMENTS
+    static constexpr size_t MAX_GSO_SEGMENT = 1472;     ///< Сегмент должен помещаться в MTU 1500
+    static constexpr size_t MAX_GSO_BYTES = 65000;      ///< Предел размера одной UDP датаграммы
+
+    size_t buildMessages(bool gso);
+
+    char buffers_[BATCH][DATAGRAM_SIZE];
+    sockaddr_in peers_[BATCH];
+    iovec recvIov_[BATCH];
+    mmsghdr recvMsgs_[BATCH];
+    alignas(cmsghdr) char recvControl_[BATCH][CONTROL_SIZE];
+
+    std::string replies_[BATCH];
+    unsigned queued_[BATCH];        ///< Номера датаграмм, на которые есть ответ
+    unsigned queuedCount_ = 0;
+
+    iovec sendIov_[BATCH];
+    mmsghdr sendMsgs_[BATCH];
+    unsigned sendSegments_[BATCH];  ///< Сколько датаграмм несет каждое сообщение sendmmsg
+    alignas(cmsghdr) char sendControl_[BATCH][CONTROL_SIZE];
+
+    uint32_t lastOverflow_ = 0;     ///< Последнее значение счетчика SO_RXQ_OVFL
+    uint32_t drops_ = 0;            ///< Потери в ядре с прошлого takeKernelDrops
+};
@@ -0,0 +1,214 @@
+#include "UdpPeerTracker.h"
+#include <chrono>
+#include <cmath>
+
+/**
+ * Конструктор учета пиров
+ * @param mode Точный (таблица с TTL) или приблизительный (HyperLogLog) подсчет
+ * @param ttlSeconds Время жизни записи о пире без новых датаграмм (точный режим)
+ * @param maxPeers Предел количества записей; новые пиры сверх него не учитываются
+ */
+UdpPeerTracker::UdpPeerTracker(Mode mode, uint32_t ttlSeconds, size_t maxPeers) :
+    mode_(mode),
+    ttl_(ttlSeconds > 0 ? ttlSeconds : 1),
+    maxPerShard_((maxPeers + SHARDS - 1) / SHARDS),
+    maxCapacity_(MIN_CAPACITY) {
+    if (mode_ == Mode::Approx) {
+        registers_ = std::make_unique<std::atomic<uint8_t>[]>(HLL_REGISTERS);
+        for (size_t i = 0; i < HLL_REGISTERS; ++i) registers_[i].store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    // Заполнение таблицы не превышает 3/4, чтобы цепочки пробирования оставались короткими
+    while (maxCapacity_ / 4 * 3 < maxPerShard_) maxCapacity_ <<= 1;
+    shards_ = std::make_unique<Shard[]>(SHARDS);
+    for (size_t i = 0; i < SHARDS; ++i) shards_[i].slots.resize(MIN_CAPACITY);
+}
+
+/**
+ * Упаковка адреса пира в 48-битный ключ
+ * @param peer Адрес пира
+ * @return IPv4 адрес в старших 32 битах, порт в младших 16
+ */
+uint64_t UdpPeerTracker::packKey(const sockaddr_in& peer) {
+    return (uint64_t{ntohl(peer.sin_addr.s_addr)} << 16) | ntohs(peer.sin_port);
+}
+
+/**
+ * Перемешивание ключа (финализатор MurmurHash3)
+ * Старшие биты выбирают шард и регистр HyperLogLog, младшие - ячейку таблицы
+ */
+uint64_t UdpPeerTracker::hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * Монотонное время в секундах
+ */
+uint32_t UdpPeerTracker::nowSeconds() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
+
+/**
+ * Учет датаграммы от пира
+ * Может вызываться из нескольких потоков одновременно
+ * @param peer Адрес отправителя
+ */
+void UdpPeerTracker::touch(const sockaddr_in& peer) {
+    uint64_t key = packKey(peer);
+    uint64_t h = hash(key);
+    if (mode_ == Mode::Approx) touchApprox(h);
+    else touchExact(key, h);
+}
+
+/**
+ * Обновление регистра HyperLogLog (без блокировок)
+ * @param h Хэш ключа пира
+ */
+void UdpPeerTracker::touchApprox(uint64_t h) {
+    size_t index = static_cast<size_t>(h >> (64 - HLL_BITS));
+    uint64_t rest = h << HLL_BITS;
+    auto rank = static_cast<uint8_t>(rest == 0 ? 64 - HLL_BITS + 1 : static_cast<unsigned>(__builtin_clzll(rest)) + 1);
+
+    std::atomic<uint8_t>& reg = registers_[index];
+    uint8_t current = reg.load(std::memory_order_relaxed);
+    while (rank > current && !reg.compare_exchange_weak(current, rank, std::memory_order_relaxed)) {}
+}
+
+/**
+ * Обновление времени пира в таблице шарда или добавление нового пира
+ * @param key Упакованный ключ пира
+ * @param h Хэш ключа
+ */
+void UdpPeerTracker::touchExact(uint64_t key, uint64_t h) {
+    Shard& s = shards_[h >> 60];
+    uint32_t now = nowSeconds();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    // Истекшие записи вычищаются понемногу с каждой датаграммой: время под блокировкой
+    // шарда не зависит от размера таблицы
+    sweep(s, SWEEP_STEP, now);
+
+    size_t mask = s.slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        Slot& slot = s.slots[i];
+        if (slot.key == key) {
+            slot.lastSeen = now;
+            return;
+        }
+        if (slot.key == EMPTY) break;
+    }
+
+    // Новый пир: при заполнении таблицы растем, на пределе - вычищаем еще часть таблицы
+    if ((s.used + 1) * 4 > s.slots.size() * 3 || s.used >= maxPerShard_) {
+        if (s.slots.size() < maxCapacity_) grow(s, now);
+        else sweep(s, FULL_SWEEP_STEP, now);
+        if ((s.used + 1) * 4 > s.slots.size() * 3 || s.used >= maxPerShard_) {
+            overflow_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mask = s.slots.size() - 1;
+    }
+
+    size_t i = h & mask;
+    while (s.slots[i].key != EMPTY) i = (i + 1) & mask;
+    s.slots[i] = Slot{key, now};
+    s.used++;
+    s.size.store(s.used, std::memory_order_relaxed);
+}
+
+/**
+ * Постепенная очистка: проверка следующих steps ячеек таблицы шарда, начиная с sweepPos
+ * Вызывается под блокировкой шарда
+ * @param s Шард
+ * @param steps Сколько ячеек проверить
+ * @param now Текущее время в секундах
+ */
+void UdpPeerTracker::sweep(Shard& s, size_t steps, uint32_t now) {
+    size_t mask = s.slots.size() - 1;
+    for (size_t n = 0; n < steps && s.used > 0; ++n) {
+        size_t i = s.sweepPos & mask;
+        const Slot& slot = s.slots[i];
+        // После удаления в ячейку может сдвинуться следующая запись - ее проверяем на следующем шаге
+        if (slot.key != EMPTY && now - slot.lastSeen >= ttl_) erase(s, i);
+        else s.sweepPos = i + 1;
+    }
+    s.size.store(s.used, std::memory_order_relaxed);
+}
+
+/**
+ * Удаление записи со сдвигом следующих записей цепочки назад (без надгробий)
+ * @param s Шард
+ * @param i Ячейка удаляемой записи
+ */
+void UdpPeerTracker::erase(Shard& s, size_t i) {
+    size_t mask = s.slots.size() - 1;
+    for (size_t j = (i + 1) & mask; s.slots[j].key != EMPTY; j = (j + 1) & mask) {
+        // Запись из j можно перенести в i, если ее домашняя ячейка не лежит в (i, j]
+        size_t home = hash(s.slots[j].key) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            s.slots[i] = s.slots[j];
+            i = j;
+        }
+    }
+    s.slots[i] = Slot{};
+    s.used--;
+}
+
+/**
+ * Удвоение таблицы шарда без истекших записей
+ * Вызывается под блокировкой шарда; за время жизни шарда происходит не больше
+ * log2(maxCapacity_ / MIN_CAPACITY) раз, стоимость на добавленного пира постоянна
+ * @param s Шард
+ * @param now Текущее время в секундах
+ */
+void UdpPeerTracker::grow(Shard& s, uint32_t now) {
+    std::vector<Slot> old(s.slots.size() * 2);
+    old.swap(s.slots);
+    s.used = 0;
+
+    size_t mask = s.slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.key == EMPTY || now - slot.lastSeen >= ttl_) continue;
+        size_t i = hash(slot.key) & mask;
+        while (s.slots[i].key != EMPTY) i = (i + 1) & mask;
+        s.slots[i] = slot;
+        s.used++;
+    }
+    s.size.store(s.used, std::memory_order_relaxed);
+}
+
+/**
+ * Количество уникальных пиров
+ * Точный режим - пиры, активные в пределах TTL (истекшие записи вычищаются
+ * постепенно, по мере прихода датаграмм),
+ * приблизительный - оценка HyperLogLog за все время работы
+ */
+size_t UdpPeerTracker::unique() const {
+    if (mode_ == Mode::Exact) {
+        size_t total = 0;
+        for (size_t i = 0; i < SHARDS; ++i) total += shards_[i].size.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    constexpr double m = static_cast<double>(HLL_REGISTERS);
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+        uint8_t r = registers_[i].load(std::memory_order_relaxed);
+        sum += std::ldexp(1.0, -r);
+        if (r == 0) zeros++;
+    }
+
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    // Для малых количеств точнее линейный подсчет по пустым регистрам
+    if (estimate <= 2.5 * m && zeros > 0)
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    return static_cast<size_t>(estimate + 0.5);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <netinet/in.h>
+
+/**
+ * Учет уникальных UDP пиров с ограниченной памятью
+ * Пир - упакованный 48-битный ключ (IPv4 адрес << 16 | порт).
+ * Точный режим: шардированные таблицы с открытой адресацией, записи истекают через TTL.
+ * Приблизительный режим: HyperLogLog на 4096 регистрах (4 КБ, ошибка ~1.6%),
+ * обновляется без блокировок и считает пиров за все время работы
+ */
+class UdpPeerTracker {
+public:
+    /// Способ подсчета уникальных пиров
+    enum class Mode {
+        Exact,      ///< Таблица активных пиров с истечением по TTL
+        Approx      ///< HyperLogLog
+    };
+
+    UdpPeerTracker(Mode mode, uint32_t ttlSeconds, size_t maxPeers);
+
+    void touch(const sockaddr_in& peer);
+    size_t unique() const;
+    size_t overflow() const { return overflow_.load(std::memory_order_relaxed); }
+
+    static uint64_t packKey(const sockaddr_in& peer);
+
+private:
+    static constexpr size_t SHARDS = 16;             ///< Количество независимо блокируемых шардов
+    static constexpr size_t MIN_CAPACITY = 64;       ///< Начальная емкость таблицы шарда
+    static constexpr size_t SWEEP_STEP = 16;         ///< Ячеек, проверяемых на истечение за датаграмму
+    static constexpr size_t FULL_SWEEP_STEP = 1024;  ///< Ячеек, проверяемых при заполненной таблице
+    static constexpr unsigned HLL_BITS = 12;         ///< log2 количества регистров HyperLogLog
+    static constexpr size_t HLL_REGISTERS = size_t{1} << HLL_BITS;
+    static constexpr uint64_t EMPTY = ~uint64_t{0};  ///< Свободная ячейка (ключ занимает 48 бит)
+
+    /// Ячейка таблицы: ключ пира и время последней датаграммы
+    struct Slot {
+        uint64_t key = EMPTY;
+        uint32_t lastSeen = 0;
+    };
+
+    /// Шард: таблица с линейным пробированием под собственной блокировкой
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        size_t used = 0;
+        size_t sweepPos = 0;            ///< Следующая ячейка постепенной очистки
+        std::atomic<size_t> size{0};    ///< Копия used для чтения без блокировки
+    };
+
+    static uint64_t hash(uint64_t key);
+    static uint32_t nowSeconds();
+
+    void touchExact(uint64_t key, uint64_t h);
+    void touchApprox(uint64_t h);
+    void sweep(Shard& s, size_t steps, uint32_t now);
+    void erase(Shard& s, size_t i);
+    void grow(Shard& s, uint32_t now);
+
+    Mode mode_;
+    uint32_t ttl_;
+    size_t maxPerShard_;               ///< Предел записей в шарде
+    size_t maxCapacity_;               ///< Предел размера таблицы шарда (степень двойки)
+    std::unique_ptr<Shard[]> shards_;
+    std::unique_ptr<std::atomic<uint8_t>[]> registers_;
+    std::atomic<size_t> overflow_{0};   ///< Новые пиры, не поместившиеся в заполненную таблицу
+};
@@ -0,0 +1,656 @@
+#include "UringBackend.h"
+#include "EpollServer.h"
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "IoUring.h"
+#include "Utils.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr unsigned RING_ENTRIES = 1024;      ///< Размер очереди отправки
+constexpr uint16_t BUFFER_GROUP = 0;         ///< Группа предоставленных буферов для recv
+constexpr unsigned BUFFER_COUNT = 256;       ///< Количество буферов (степень двойки)
+constexpr unsigned BUFFER_SIZE = 4096;       ///< Размер одного буфера
+constexpr size_t UDP_SLOTS = 32;             ///< Одновременно ожидающих recvmsg на UDP сокете
+constexpr size_t UDP_BUFFER = 2048;          ///< Максимальный размер датаграммы
+
+/// Тип операции, закодированный в старших битах user_data
+enum Op : uint64_t {
+    OP_ACCEPT = 1,
+    OP_RECV,
+    OP_SEND,
+    OP_UDP_RECV,
+    OP_UDP_SEND,
+    OP_TIMEOUT,
+    OP_CANCEL,
+    OP_MAIL,
+};
+
+/// Слушающий сокет accept (id в user_data)
+constexpr uint32_t ACCEPT_TCP = 0;
+constexpr uint32_t ACCEPT_UNIX = 1;
+
+uint64_t pack(Op op, uint32_t id) { return (static_cast<uint64_t>(op) << 56) | id; }
+Op opOf(uint64_t data) { return static_cast<Op>(data >> 56); }
+uint32_t idOf(uint64_t data) { return static_cast<uint32_t>(data); }
+
+/**
+ * Цикл одного реактора на io_uring
+ * Сокет закрывается только после завершения всех его операций в кольце,
+ * поэтому CQE не могут относиться к переиспользованному номеру fd
+ */
+class UringLoop {
+public:
+    UringLoop(EpollServer& server, Reactor& r) : server_(server), r_(r) {}
+
+    bool init();
+    void run();
+
+private:
+    /// Состояние соединения, относящееся к io_uring
+    struct Conn {
+        Client* client = nullptr;
+        bool recvArmed = false;       ///< Действует multishot recv
+        bool cancelRequested = false; ///< Отправлен ASYNC_CANCEL для recv
+        bool sendInFlight = false;    ///< В кольце есть незавершенный sendmsg
+        bool closing = false;         ///< Соединение закрывается после завершения операций
+        bool paused = false;          ///< Чтение остановлено по порогу очереди ответов
+        bool dirty = false;           ///< Есть новые ответы для отправки
+        uint64_t receivedAt = 0;      ///< Прием данных, на которые еще не отправлен ответ (нс)
+        iovec iov[OutputQueue::MAX_IOV];
+        msghdr msg{};
+    };
+
+    /// Слот UDP: принятая датаграмма и ответ на нее
+    struct UdpSlot {
+        char buf[UDP_BUFFER];
+        sockaddr_in peer{};
+        iovec iov{};
+        msghdr msg{};
+        alignas(cmsghdr) char control[64];   ///< SO_RXQ_OVFL - счетчик потерь в ядре
+        std::string reply;
+    };
+
+    void handleCqe(const io_uring_cqe& cqe);
+    void onAccept(const io_uring_cqe& cqe);
+    void onRecv(const io_uring_cqe& cqe);
+    void onSend(const io_uring_cqe& cqe);
+    void onUdpRecv(const io_uring_cqe& cqe);
+    void onMail(const io_uring_cqe& cqe);
+
+    void armAccept(uint32_t id);
+    void armRecv(int fd, Conn& conn);
+    void armUdpRecv(uint32_t slot);
+    void armTimeout();
+    void armMail();
+    void cancel(uint64_t userData);
+    void cancelRecv(int fd, Conn& conn);
+    void drain();
+    void markDirty(int fd, Conn& conn);
+    void flushDirty();
+    void maybeFinalize(int fd);
+    void expire(uint64_t token);
+    void wake(uint64_t token);
+    void closeAll();
+    int wait();
+
+    io_uring_sqe* sqe();
+
+    EpollServer& server_;
+    Reactor& r_;
+    std::unordered_map<int, Conn> conns_;
+    std::vector<int> dirty_;
+    std::vector<UdpSlot> udpSlots_{UDP_SLOTS};
+    size_t udpReceived_ = 0;          ///< Датаграмм за текущую итерацию (одна пачка)
+    size_t udpTxDropped_ = 0;         ///< Неотправленных ответов за итерацию
+    uint32_t udpOverflow_ = 0;        ///< Последнее значение SO_RXQ_OVFL
+    size_t udpRxDropped_ = 0;         ///< Потери в ядре за итерацию
+    __kernel_timespec tick_{1, 0};    ///< Период пробуждения: флаг завершения и колесо таймеров
+    IoUring ring_;                    ///< Объявлено последним: закрывается первым
+};
+
+/**
+ * Получение SQE; при переполнении кольца ждем, пока ядро заберет очередь
+ */
+io_uring_sqe* UringLoop::sqe() {
+    io_uring_sqe* s;
+    while ((s = ring_.getSqe()) == nullptr) ring_.submitAndWait(1);
+    return s;
+}
+
+/**
+ * Создание кольца и буферов
+ * @return false, если io_uring или кольцо буферов недоступны
+ */
+bool UringLoop::init() {
+    return ring_.init(RING_ENTRIES) && ring_.registerBufferRing(BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE);
+}
+
+/**
+ * Основной цикл: одна отправка SQE и ожидание CQE на итерацию
+ */
+void UringLoop::run() {
+    // С таймаутами соединений просыпаемся с шагом колеса таймеров
+    if (server_.timeouts()) tick_ = {0, static_cast<long long>(TimerWheel::TICK_MS) * 1000000};
+    armAccept(ACCEPT_TCP);
+    if (r_.unixFd >= 0) armAccept(ACCEPT_UNIX);
+    for (uint32_t i = 0; i < UDP_SLOTS; ++i) armUdpRecv(i);
+    armTimeout();
+    armMail();
+    bool drained = false;    // Работа передана новому процессу (--handoff)
+
+    while (!server_.shuttingDown()) {
+        FlightRecorder::record(FlightRecorder::Event::WaitBegin);
+        int ret = wait();
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            Logger::log(Logger::Level::Error, "io_uring_enter: %s", strerror(-ret));
+            break;
+        }
+
+        uint64_t completions = 0;
+        ring_.forEachCqe([this, &completions](const io_uring_cqe& cqe) {
+            handleCqe(cqe);
+            ++completions;
+        });
+        if (completions > 0) Metrics::record(Metrics::Histogram::EventBatch, completions);
+        FlightRecorder::record(FlightRecorder::Event::WaitEnd, -1, completions);
+
+        // Датаграммы, завершенные за итерацию, учитываются как одна пачка
+        server_.recordUdpBatch(udpReceived_, udpRxDropped_, udpTxDropped_);
+        udpReceived_ = udpRxDropped_ = udpTxDropped_ = 0;
+        if (server_.shuttingDown()) break;
+
+        // Соединения с истекшим таймаутом закрываются после завершения их операций в кольце
+        server_.expireClients(r_);
+        for (uint64_t token : r_.woken) wake(token);
+        for (uint64_t token : r_.expired) expire(token);
+
+        // Ответы всех соединений, накопленные за итерацию, уйдут следующим io_uring_enter
+        flushDirty();
+
+        if (!drained && server_.draining()) {
+            drain();
+            drained = true;
+        }
+    }
+
+    closeAll();
+}
+
+/**
+ * Отправка SQE и ожидание завершений
+ * В режиме низкой задержки кольцо сначала опрашивается без сна в течение бюджета опроса
+ * @return Результат io_uring_enter или -errno
+ */
+int UringLoop::wait() {
+    if (uint64_t spin = server_.spinNs()) {
+        uint64_t deadline = Metrics::nowNs() + spin;
+        do {
+            int ret = ring_.submitAndPoll();
+            if (ret < 0 || ring_.hasCqe() || server_.shuttingDown()) return ret;
+            cpuRelax();
+        } while (Metrics::nowNs() < deadline);
+    }
+    return ring_.submitAndWait(1);
+}
+
+void UringLoop::handleCqe(const io_uring_cqe& cqe) {
+    switch (opOf(cqe.user_data)) {
+        case OP_ACCEPT: onAccept(cqe); break;
+        case OP_RECV: onRecv(cqe); break;
+        case OP_SEND: onSend(cqe); break;
+        case OP_UDP_RECV: onUdpRecv(cqe); break;
+        case OP_UDP_SEND:
+            if (cqe.res < 0) ++udpTxDropped_;
+            else Metrics::add(Metrics::Counter::UdpBytesOut, static_cast<uint64_t>(cqe.res));
+            armUdpRecv(idOf(cqe.user_data));
+            break;
+        case OP_TIMEOUT: armTimeout(); break;
+        case OP_MAIL: onMail(cqe); break;
+        case OP_CANCEL: break;
+    }
+}
+
+/**
+ * Новое соединение от multishot accept
+ */
+void UringLoop::onAccept(const io_uring_cqe& cqe) {
+    if (cqe.res >= 0) {
+        int fd = cqe.res;
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        // У клиента Unix сокета адреса нет - отмечаем только семейство
+        if (idOf(cqe.user_data) == ACCEPT_UNIX) addr.sin_family = AF_UNIX;
+        else getpeername(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+
+        Client* c = server_.registerClient(r_, fd, addr);
+        if (c) {
+            Conn& conn = conns_[fd];
+            conn = Conn{};
+            conn.client = c;
+            armRecv(fd, conn);
+        } else {
+            close(fd);
+        }
+    } else if (cqe.res != -ECANCELED && cqe.res != -EAGAIN) {
+        static Logger::RateLimit acceptErrorLog(10);
+        Logger::log(acceptErrorLog, Logger::Level::Error, "accept: %s", strerror(-cqe.res));
+    }
+
+    // Multishot accept завершился (ошибка или переполнение) - ставим заново
+    if (!(cqe.flags & IORING_CQE_F_MORE)) armAccept(idOf(cqe.user_data));
+}
+
+/**
+ * Данные от multishot recv
+ */
+void UringLoop::onRecv(const io_uring_cqe& cqe) {
+    int fd = static_cast<int>(idOf(cqe.user_data));
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) return;
+    Conn& conn = it->second;
+
+    if (!(cqe.flags & IORING_CQE_F_MORE)) conn.recvArmed = false;
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0 && !conn.closing) {
+            // Копируем сегмент во входной буфер клиента и сразу возвращаем буфер ядру
+            Client& c = *conn.client;
+            auto n = static_cast<size_t>(cqe.res);
+            if (conn.receivedAt == 0) conn.receivedAt = Metrics::nowNs();
+            Metrics::add(Metrics::Counter::TcpBytesIn, n);
+
+            // Сегмент может закончить кадр, под который буфер выделен ровно по размеру:
+            // копируем до конца места и разбираем, прежде чем брать новый блок
+            const char* src = ring_.buffer(bid);
+            bool accepted = true;
+            while (n > 0 && accepted) {
+                size_t room;
+                char* dst = c.buffer.prepare(std::min(n, EpollServer::recvHint(c)), room);
+                size_t part = std::min(n, room);
+                std::memcpy(dst, src, part);
+                c.buffer.commit(part);
+                src += part;
+                n -= part;
+                accepted = server_.processInput(c);
+            }
+            ring_.recycleBuffer(bid);
+
+            if (!accepted) {
+                // Строка или кадр длиннее предела: ошибка уходит синхронно, соединение закрывается
+                if (!conn.sendInFlight) c.out.flush(fd);
+                conn.closing = true;
+            }
+            server_.touchClient(c, conn.receivedAt);
+            markDirty(fd, conn);
+
+            // Клиент не забирает ответы - останавливаем чтение до опустошения очереди
+            if (c.out.pending() > server_.outHighWater() && !conn.paused) {
+                conn.paused = true;
+                cancelRecv(fd, conn);
+            }
+        } else {
+            ring_.recycleBuffer(bid);
+        }
+    }
+
+    if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) {
+        conn.closing = true;    // Разрыв соединения или ошибка
+    }
+
+    // recv завершился без закрытия (например, кончились буферы) - ставим заново
+    if (!conn.recvArmed && !conn.closing && !conn.paused) armRecv(fd, conn);
+
+    maybeFinalize(fd);
+}
+
+/**
+ * Завершение sendmsg
+ */
+void UringLoop::onSend(const io_uring_cqe& cqe) {
+    int fd = static_cast<int>(idOf(cqe.user_data));
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) return;
+    Conn& conn = it->second;
+    Client& c = *conn.client;
+
+    conn.sendInFlight = false;
+    if (cqe.res < 0) {
+        conn.closing = true;
+    } else {
+        Metrics::add(Metrics::Counter::TcpBytesOut, static_cast<uint64_t>(cqe.res));
+        FlightRecorder::record(FlightRecorder::Event::Send, fd, static_cast<uint64_t>(cqe.res));
+        c.out.consume(static_cast<size_t>(cqe.res));
+        if (cqe.res > 0 && server_.timeouts()) server_.touchClient(c, Metrics::nowNs());
+        // Очередь опустилась ниже половины порога - возобновляем чтение
+        if (conn.paused && c.out.pending() <= server_.outHighWater() / 2) {
+            conn.paused = false;
+            conn.cancelRequested = false;
+            if (!conn.recvArmed) armRecv(fd, conn);
+        }
+        // Сопрограмма ждала опустошения очереди - дописывает следующую часть
+        if (!conn.closing && server_.writerReady(c) && !server_.resumeSession(c, Session::Wait::Write)) {
+            c.out.flush(fd);
+            conn.closing = true;
+        }
+        markDirty(fd, conn);    // Отправляем остаток
+    }
+
+    maybeFinalize(fd);
+}
+
+/**
+ * Датаграмма от recvmsg
+ */
+void UringLoop::onUdpRecv(const io_uring_cqe& cqe) {
+    uint32_t slot = idOf(cqe.user_data);
+    UdpSlot& s = udpSlots_[slot];
+
+    if (cqe.res > 0) {
+        ++udpReceived_;
+        Metrics::add(Metrics::Counter::UdpBytesIn, static_cast<uint64_t>(cqe.res));
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&s.msg); cm; cm = CMSG_NXTHDR(&s.msg, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t overflow;
+                std::memcpy(&overflow, CMSG_DATA(cm), sizeof(overflow));
+                // Слоты завершаются не по порядку - учитываем только рост счетчика
+                if (overflow > udpOverflow_) {
+                    udpRxDropped_ += overflow - udpOverflow_;
+                    udpOverflow_ = overflow;
+                }
+            }
+        }
+    }
+
+    if (cqe.res > 0 &&
+        server_.handleDatagram(r_, std::string_view(s.buf, static_cast<size_t>(cqe.res)), s.peer, s.reply)) {
+        // Ответ уходит из того же слота, после отправки слот снова ждет датаграмму
+        s.iov.iov_base = s.reply.data();
+        s.iov.iov_len = s.reply.size();
+        s.msg = msghdr{};
+        s.msg.msg_name = &s.peer;
+        s.msg.msg_namelen = sizeof(s.peer);
+        s.msg.msg_iov = &s.iov;
+        s.msg.msg_iovlen = 1;
+
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_SENDMSG;
+        e->fd = r_.udpFd;
+        e->addr = reinterpret_cast<uint64_t>(&s.msg);
+        e->len = 1;
+        e->user_data = pack(OP_UDP_SEND, slot);
+        return;
+    }
+
+    armUdpRecv(slot);
+}
+
+/**
+ * Сообщения каналов в почтовом ящике реактора
+ * eventfd сбрасывается до забора сообщений: издатель, положивший сообщение после забора, разбудит снова
+ */
+void UringLoop::onMail(const io_uring_cqe& cqe) {
+    if (cqe.res >= 0) {
+        uint64_t value;
+        while (read(r_.mailFd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+        PubSub::take(r_);
+        for (const Delivery& d : r_.delivering) {
+            auto it = conns_.find(ConnectionTable::tokenFd(d.token));
+            if (it == conns_.end() || it->second.closing ||
+                it->second.client->generation != ConnectionTable::tokenGeneration(d.token))
+                continue;
+            if (server_.deliver(*it->second.client, d)) markDirty(it->first, it->second);
+        }
+    }
+    armMail();
+}
+
+/**
+ * Multishot accept на TCP сокете реактора или на общем Unix сокете
+ * @param id ACCEPT_TCP или ACCEPT_UNIX
+ */
+void UringLoop::armAccept(uint32_t id) {
+    if (server_.shuttingDown() || server_.draining()) return;
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_ACCEPT;
+    e->fd = id == ACCEPT_UNIX ? r_.unixFd : r_.listenFd;
+    e->ioprio = IORING_ACCEPT_MULTISHOT;
+    e->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    e->user_data = pack(OP_ACCEPT, id);
+}
+
+void UringLoop::armRecv(int fd, Conn& conn) {
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_RECV;
+    e->fd = fd;
+    e->ioprio = IORING_RECV_MULTISHOT;
+    e->flags = IOSQE_BUFFER_SELECT;
+    e->buf_group = BUFFER_GROUP;
+    e->user_data = pack(OP_RECV, static_cast<uint32_t>(fd));
+    conn.recvArmed = true;
+    conn.cancelRequested = false;
+}
+
+void UringLoop::armUdpRecv(uint32_t slot) {
+    if (server_.shuttingDown() || server_.draining()) return;
+    UdpSlot& s = udpSlots_[slot];
+    s.iov.iov_base = s.buf;
+    s.iov.iov_len = sizeof(s.buf);
+    s.msg = msghdr{};
+    s.msg.msg_name = &s.peer;
+    s.msg.msg_namelen = sizeof(s.peer);
+    s.msg.msg_iov = &s.iov;
+    s.msg.msg_iovlen = 1;
+    s.msg.msg_control = s.control;
+    s.msg.msg_controllen = sizeof(s.control);
+
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_RECVMSG;
+    e->fd = r_.udpFd;
+    e->addr = reinterpret_cast<uint64_t>(&s.msg);
+    e->len = 1;
+    e->user_data = pack(OP_UDP_RECV, slot);
+}
+
+void UringLoop::armTimeout() {
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_TIMEOUT;
+    e->addr = reinterpret_cast<uint64_t>(&tick_);
+    e->len = 1;
+    e->user_data = pack(OP_TIMEOUT, 0);
+}
+
+void UringLoop::armMail() {
+    if (server_.shuttingDown()) return;
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_POLL_ADD;
+    e->fd = r_.mailFd;
+    e->poll32_events = POLLIN;
+    e->user_data = pack(OP_MAIL, 0);
+}
+
+void UringLoop::cancel(uint64_t userData) {
+    io_uring_sqe* e = sqe();
+    e->opcode = IORING_OP_ASYNC_CANCEL;
+    e->addr = userData;
+    e->user_data = pack(OP_CANCEL, idOf(userData));
+}
+
+void UringLoop::cancelRecv(int fd, Conn& conn) {
+    if (!conn.recvArmed || conn.cancelRequested) return;
+    cancel(pack(OP_RECV, static_cast<uint32_t>(fd)));
+    conn.cancelRequested = true;
+}
+
+/**
+ * Передача работы новому процессу (--handoff)
+ * Accept и ожидающие recvmsg отменяются и больше не ставятся: соединения и датаграммы
+ * получает новый процесс. Открытые соединения не передаются - multishot recv может уже
+ * держать их данные в кольце, - они обслуживаются здесь до закрытия
+ */
+void UringLoop::drain() {
+    cancel(pack(OP_ACCEPT, ACCEPT_TCP));
+    if (r_.unixFd >= 0) cancel(pack(OP_ACCEPT, ACCEPT_UNIX));
+    for (uint32_t i = 0; i < UDP_SLOTS; ++i) cancel(pack(OP_UDP_RECV, i));
+    server_.reactorDrained();
+}
+
+void UringLoop::markDirty(int fd, Conn& conn) {
+    if (conn.dirty) return;
+    conn.dirty = true;
+    dirty_.push_back(fd);
+}
+
+/**
+ * Постановка sendmsg для всех соединений с новыми ответами
+ * На соединение - не более одного sendmsg в полете, чтобы сохранить порядок байт
+ */
+void UringLoop::flushDirty() {
+    for (int fd : dirty_) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) continue;
+        Conn& conn = it->second;
+        conn.dirty = false;
+        Client& c = *conn.client;
+        if (conn.closing || conn.sendInFlight || c.out.empty()) continue;
+
+        conn.msg = msghdr{};
+        conn.msg.msg_iov = conn.iov;
+        conn.msg.msg_iovlen = static_cast<size_t>(c.out.prepareIov(conn.iov, OutputQueue::MAX_IOV));
+
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_SENDMSG;
+        e->fd = fd;
+        e->addr = reinterpret_cast<uint64_t>(&conn.msg);
+        e->len = 1;
+        e->msg_flags = MSG_NOSIGNAL;
+        e->user_data = pack(OP_SEND, static_cast<uint32_t>(fd));
+        conn.sendInFlight = true;
+
+        if (conn.receivedAt != 0) {
+            Metrics::record(Metrics::Histogram::ReadToReply, Metrics::nowNs() - conn.receivedAt);
+            conn.receivedAt = 0;
+        }
+    }
+    dirty_.clear();
+}
+
+/**
+ * Закрытие соединения, когда по нему не осталось операций в кольце
+ */
+void UringLoop::maybeFinalize(int fd) {
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) return;
+    Conn& conn = it->second;
+    if (!conn.closing) return;
+
+    if (conn.recvArmed) {
+        cancelRecv(fd, conn);
+        return;
+    }
+    if (conn.sendInFlight) return;
+
+    // Слот освобождается до close(fd): номер может сразу достаться соединению другого реактора
+    server_.unregisterClient(r_, fd);
+    close(fd);
+    conns_.erase(it);
+}
+
+/**
+ * Закрытие соединения по таймауту
+ * @param token Идентификатор соединения (fd и поколение)
+ */
+void UringLoop::expire(uint64_t token) {
+    auto it = conns_.find(ConnectionTable::tokenFd(token));
+    if (it == conns_.end() || it->second.client->generation != ConnectionTable::tokenGeneration(token)) return;
+    it->second.closing = true;
+    maybeFinalize(it->first);
+}
+
+/**
+ * Возобновление сопрограммы соединения после sleep
+ * @param token Идентификатор соединения (fd и поколение)
+ */
+void UringLoop::wake(uint64_t token) {
+    auto it = conns_.find(ConnectionTable::tokenFd(token));
+    if (it == conns_.end() || it->second.client->generation != ConnectionTable::tokenGeneration(token)) return;
+    int fd = it->first;
+    Conn& conn = it->second;
+    if (conn.closing) return;
+    if (!server_.resumeSession(*conn.client, Session::Wait::Sleep)) {
+        if (!conn.sendInFlight) conn.client->out.flush(fd);
+        conn.closing = true;
+        maybeFinalize(fd);
+        return;
+    }
+    markDirty(fd, conn);
+}
+
+/**
+ * Уведомление клиентов о завершении работы и закрытие соединений
+ */
+void UringLoop::closeAll() {
+    // Дожидаемся sendmsg, уже переданных ядру, чтобы не потерять и не задвоить данные.
+    // Ожидание ограничено: таймер пробуждения срабатывает раз в секунду
+    auto inFlight = [this] {
+        for (auto& [fd, conn] : conns_)
+            if (conn.sendInFlight) return true;
+        return false;
+    };
+    for (int attempt = 0; attempt < 4 && inFlight(); ++attempt) {
+        ring_.submitAndWait(1);
+        ring_.forEachCqe([this](const io_uring_cqe& cqe) { handleCqe(cqe); });
+    }
+
+    for (auto& [fd, conn] : conns_) {
+        Client& c = *conn.client;
+        server_.notifyShutdown(c);
+        if (!conn.sendInFlight) c.out.flush(fd);
+        server_.unregisterClient(r_, fd);
+        close(fd);
+    }
+    conns_.clear();
+}
+
+} // namespace
+
+/**
+ * Конструктор io_uring backend'а
+ * @param server Сервер с общей логикой соединений и команд
+ */
+UringBackend::UringBackend(EpollServer& server) : server_(server) {}
+
+/**
+ * Проверка поддержки io_uring и кольца предоставленных буферов ядром
+ * @return true, если backend можно использовать
+ */
+bool UringBackend::supported() {
+    IoUring probe;
+    return probe.init(8) && probe.registerBufferRing(BUFFER_GROUP, 8, 64);
+}
+
+/**
+ * Цикл обработки событий реактора
+ * @param r Реактор с созданными сокетами
+ */
+void UringBackend::run(Reactor& r) {
+    UringLoop loop(server_, r);
+    if (!loop.init()) {
+        perror("io_uring");
+        exit(1);
+    }
+    loop.run();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "IoBackend.h"
+
+class EpollServer;
+
+/**
+ * Backend на io_uring
+ * TCP: multishot accept, multishot recv с кольцом предоставленных буферов,
+ * ответы всех соединений отправляются одним io_uring_enter на итерацию цикла.
+ * UDP: пул заранее поставленных recvmsg, ответ уходит sendmsg из того же слота.
+ * Каждый реактор владеет своим кольцом; пул потоков не используется
+ */
+class UringBackend : public IoBackend {
+public:
+    explicit UringBackend(EpollServer& server);
+
+    static bool supported();
+
+    void run(Reactor& r) override;
+
+private:
+    EpollServer& server_;
+};
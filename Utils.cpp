@@ -3,7 +3,11 @@
 
 #include "Utils.h"
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 
 /**
@@ -19,19 +23,83 @@ int makeNonBlocking(int fd)
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
+/**
+ * Записывает текущее время в формате "YYYY-MM-DD HH:MM:SS" в буфер
+ * Форматирование выполняется раз в секунду на поток, остальные вызовы копируют готовую строку
+ * @param buf Буфер для строки
+ * @param size Размер буфера
+ * @return Длина строки без завершающего нуля
+ */
+size_t formatNow(char* buf, size_t size)
+{
+    thread_local std::time_t cachedAt = -1;
+    thread_local char cached[32];
+    thread_local size_t cachedLen = 0;
+
+    // Получаем текущее системное время
+    auto t = std::time(nullptr);
+    if (t != cachedAt) {
+        // Форматируем время в читаемый строковый формат
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        cachedLen = std::strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &tm);
+        cachedAt = t;
+    }
+    size_t len = cachedLen < size ? cachedLen : size - 1;
+    std::memcpy(buf, cached, len);
+    buf[len] = '\0';
+    return len;
+}
+
 /**
  * Возвращает текущее время в формате "YYYY-MM-DD HH:MM:SS"
- * Используется для команды /time
  * @return Строка с текущей датой и временем
  */
 std::string nowString()
 {
-    // Получаем текущее системное время
-    auto t = std::time(nullptr);
     char buf[32];
-    // Форматируем время в читаемый строковый формат
-    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
-    return buf;
+    return std::string(buf, formatNow(buf, sizeof(buf)));
+}
+
+/**
+ * Разбор списка ядер вида "0,2-5"
+ * @param text Список номеров и диапазонов через запятую
+ * @param cpus [out] Номера ядер в порядке перечисления
+ * @return false, если список пуст или содержит ошибку
+ */
+bool parseCpuList(const std::string& text, std::vector<int>& cpus)
+{
+    cpus.clear();
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return false;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = std::strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) cpus.push_back(static_cast<int>(cpu));
+        if (*end == ',') ++end;
+        else if (*end != '\0') return false;
+        p = end;
+    }
+    return !cpus.empty();
+}
+
+/**
+ * Закрепление текущего потока за ядром
+ * @param cpu Номер ядра
+ * @return true при успехе
+ */
+bool pinThread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<size_t>(cpu), &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
 }
 
 #endif
\ No newline at end of file
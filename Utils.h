@@ -1,5 +1,19 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <vector>
 
 int makeNonBlocking(int fd);
+size_t formatNow(char* buf, size_t size);
 std::string nowString();
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+bool pinThread(int cpu);
+
+/// Подсказка процессору внутри цикла опроса: освобождает ресурсы соседнему гиперпотоку
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
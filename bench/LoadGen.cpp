@@ -0,0 +1,729 @@
+#include "../Metrics.h"
+#include "../ShmRing.h"
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Нагрузочный клиент для Testing_Task
+ * Сценарии:
+ *   echo      - эхо по TCP, один запрос в полете на соединение
+ *   pipeline  - эхо по TCP, --depth запросов в полете на соединение
+ *   commands  - смесь /time, /stats и эха по TCP (--mix time:1,stats:1,echo:8)
+ *   udp       - поток датаграмм, --depth в полете на сокет
+ *   churn     - подключение, один запрос, закрытие
+ *   shm       - эхо через кольца в разделяемой памяти (/shm по Unix сокету --unix)
+ * С --unix PATH сценарии echo, pipeline и commands подключаются к Unix сокету сервера.
+ * Результат - JSON в stdout: пропускная способность, p50/p99/p999 задержки, ошибки.
+ * --replay FILE выполняет по очереди фазы из JSON lines файла (строки без "scenario"
+ * пропускаются) и выводит JSON массив результатов.
+ * Запуск: tt_loadgen [--host A] [--port P] [--unix PATH] [--scenario S] [--threads N] [--connections N]
+ *                    [--depth N] [--size BYTES] [--duration SEC] [--mix SPEC] [--replay FILE]
+ */
+
+namespace {
+
+/// Параметры одной фазы нагрузки
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string unixPath;       ///< Unix сокет сервера вместо TCP (пусто - TCP)
+    std::string scenario = "echo";
+    int threads = 2;
+    int connections = 16;       ///< Соединений (UDP сокетов) на поток
+    int depth = 1;              ///< Запросов в полете на соединение
+    size_t size = 32;           ///< Размер эхо запроса вместе с '\n'
+    double duration = 5;        ///< Длительность, секунды
+    std::string mix = "time:1,stats:1,echo:8";
+};
+
+/// Результат потока или всей фазы
+struct Result {
+    uint64_t requests = 0;
+    uint64_t bytesOut = 0;
+    uint64_t bytesIn = 0;
+    uint64_t connectErrors = 0;
+    uint64_t sendErrors = 0;
+    uint64_t recvErrors = 0;
+    uint64_t lost = 0;          ///< UDP ответы, не пришедшие за UDP_TIMEOUT
+    Metrics::HistogramData latency;
+
+    void merge(const Result& o) {
+        requests += o.requests;
+        bytesOut += o.bytesOut;
+        bytesIn += o.bytesIn;
+        connectErrors += o.connectErrors;
+        sendErrors += o.sendErrors;
+        recvErrors += o.recvErrors;
+        lost += o.lost;
+        latency.merge(o.latency);
+    }
+};
+
+constexpr uint64_t UDP_TIMEOUT_NS = 200'000'000;    ///< Ответ UDP считается потерянным
+
+uint64_t nowNs() { return Metrics::nowNs(); }
+
+/// Быстрый генератор для выбора команды из смеси
+struct XorShift {
+    uint64_t state;
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+/// Взвешенная смесь запросов для сценария commands
+struct Mix {
+    std::vector<std::pair<std::string, unsigned>> entries;   ///< Строка запроса и вес
+    unsigned total = 0;
+
+    Mix(const std::string& spec, const std::string& echoLine) {
+        size_t pos = 0;
+        while (pos < spec.size()) {
+            size_t end = spec.find(',', pos);
+            if (end == std::string::npos) end = spec.size();
+            std::string item = spec.substr(pos, end - pos);
+            pos = end + 1;
+
+            size_t colon = item.find(':');
+            std::string name = item.substr(0, colon);
+            unsigned weight = colon == std::string::npos ? 1u
+                              : static_cast<unsigned>(std::strtoul(item.c_str() + colon + 1, nullptr, 10));
+            if (weight == 0) continue;
+            std::string line = name == "echo" ? echoLine : "/" + name + "\n";
+            entries.emplace_back(line, weight);
+            total += weight;
+        }
+        if (entries.empty()) {
+            entries.emplace_back(echoLine, 1);
+            total = 1;
+        }
+    }
+
+    const std::string& pick(XorShift& rng) const {
+        unsigned r = static_cast<unsigned>(rng.next() % total);
+        for (auto& [line, weight] : entries) {
+            if (r < weight) return line;
+            r -= weight;
+        }
+        return entries.back().first;
+    }
+};
+
+sockaddr_in resolve(const Options& o) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(o.port));
+    if (inet_pton(AF_INET, o.host.c_str(), &addr.sin_addr) != 1) {
+        std::fprintf(stderr, "Error: Invalid host: %s\n", o.host.c_str());
+        exit(1);
+    }
+    return addr;
+}
+
+/**
+ * Неблокирующее подключение к серверу по TCP или, с --unix, по Unix сокету
+ * @return Дескриптор или -1
+ */
+int connectStream(const Options& o, const sockaddr_in& addr) {
+    if (o.unixPath.empty()) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    sockaddr_un ua{};
+    ua.sun_family = AF_UNIX;
+    std::snprintf(ua.sun_path, sizeof(ua.sun_path), "%s", o.unixPath.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (connect(fd, (sockaddr*)&ua, sizeof(ua)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// TCP соединение нагрузочного потока
+struct TcpConn {
+    int fd = -1;
+    bool connected = false;
+    bool wantWrite = true;
+    std::deque<uint64_t> inFlight;      ///< Время отправки запросов без ответа (ответы приходят по порядку)
+    std::string tx;
+    size_t txOff = 0;
+};
+
+/**
+ * Нагрузка по TCP (echo, pipeline, commands) на epoll
+ * Каждый ответ сервера - ровно одна строка, поэтому ответы сопоставляются
+ * с запросами по порядку
+ */
+Result runTcp(const Options& o, uint64_t deadline, unsigned seed) {
+    Result res;
+    sockaddr_in addr = o.unixPath.empty() ? resolve(o) : sockaddr_in{};
+    std::string echoLine(o.size > 1 ? o.size - 1 : 1, 'x');
+    echoLine += '\n';
+    Mix mix(o.scenario == "commands" ? o.mix : "echo:1", echoLine);
+    XorShift rng{0x9e3779b97f4a7c15ull ^ seed};
+    size_t depth = static_cast<size_t>(o.depth > 0 ? o.depth : 1);
+
+    int ep = epoll_create1(0);
+    std::vector<TcpConn> conns(static_cast<size_t>(o.connections));
+    for (size_t i = 0; i < conns.size(); ++i) {
+        TcpConn& c = conns[i];
+        c.fd = connectStream(o, addr);
+        if (c.fd < 0) {
+            res.connectErrors++;
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    auto drop = [&](TcpConn& c) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+    };
+
+    // Дозаполнение конвейера и отправка накопленного
+    auto pump = [&](size_t index) {
+        TcpConn& c = conns[index];
+        while (c.inFlight.size() < depth) {
+            const std::string& line = mix.pick(rng);
+            c.tx += line;
+            c.inFlight.push_back(nowNs());
+        }
+        while (c.txOff < c.tx.size()) {
+            ssize_t n = send(c.fd, c.tx.data() + c.txOff, c.tx.size() - c.txOff, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                res.sendErrors++;
+                drop(c);
+                return;
+            }
+            c.txOff += static_cast<size_t>(n);
+            res.bytesOut += static_cast<uint64_t>(n);
+        }
+        if (c.txOff == c.tx.size()) {
+            c.tx.clear();
+            c.txOff = 0;
+        }
+        bool want = !c.tx.empty();
+        if (want != c.wantWrite) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | (want ? EPOLLOUT : 0u);
+            ev.data.u64 = index;
+            epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+            c.wantWrite = want;
+        }
+    };
+
+    epoll_event events[256];
+    char buf[65536];
+    while (nowNs() < deadline) {
+        int n = epoll_wait(ep, events, 256, 10);
+        for (int i = 0; i < n; ++i) {
+            size_t index = events[i].data.u64;
+            TcpConn& c = conns[index];
+            if (c.fd < 0) continue;
+
+            if (!c.connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    res.connectErrors++;
+                    drop(c);
+                    continue;
+                }
+                c.connected = true;
+            }
+
+            if (events[i].events & EPOLLIN) {
+                ssize_t got = recv(c.fd, buf, sizeof(buf), 0);
+                if (got <= 0 && !(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+                    res.recvErrors++;
+                    drop(c);
+                    continue;
+                }
+                if (got > 0) {
+                    res.bytesIn += static_cast<uint64_t>(got);
+                    uint64_t now = nowNs();
+                    for (const char* p = buf; (p = static_cast<const char*>(
+                             std::memchr(p, '\n', static_cast<size_t>(buf + got - p)))); ++p) {
+                        if (c.inFlight.empty()) break;
+                        res.latency.add(now - c.inFlight.front());
+                        c.inFlight.pop_front();
+                        res.requests++;
+                    }
+                }
+            }
+            if (c.fd >= 0) pump(index);
+        }
+    }
+
+    for (TcpConn& c : conns)
+        if (c.fd >= 0) close(c.fd);
+    close(ep);
+    return res;
+}
+
+/// UDP сокет нагрузочного потока
+struct UdpSock {
+    int fd = -1;
+    size_t inFlight = 0;
+    uint64_t lastReply = 0;
+};
+
+/**
+ * Поток датаграмм: в каждой время отправки, сервер возвращает ее без изменений
+ */
+Result runUdp(const Options& o, uint64_t deadline) {
+    Result res;
+    sockaddr_in addr = resolve(o);
+    size_t depth = static_cast<size_t>(o.depth > 0 ? o.depth : 1);
+    size_t size = o.size < 18 ? 18 : o.size;
+
+    int ep = epoll_create1(0);
+    std::vector<UdpSock> socks(static_cast<size_t>(o.connections));
+    for (size_t i = 0; i < socks.size(); ++i) {
+        UdpSock& s = socks[i];
+        s.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (connect(s.fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            res.connectErrors++;
+            close(s.fd);
+            s.fd = -1;
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, s.fd, &ev);
+    }
+
+    std::string payload(size, 'x');
+    auto fill = [&](UdpSock& s) {
+        while (s.inFlight < depth) {
+            // 'u' в начале: датаграмма не должна начинаться с '/'
+            std::snprintf(&payload[0], 18, "u%016llx", static_cast<unsigned long long>(nowNs()));
+            payload[17] = 'x';
+            ssize_t n = send(s.fd, payload.data(), payload.size(), 0);
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED) res.sendErrors++;
+                break;
+            }
+            res.bytesOut += static_cast<uint64_t>(n);
+            s.inFlight++;
+        }
+    };
+
+    uint64_t start = nowNs();
+    for (UdpSock& s : socks) {
+        if (s.fd < 0) continue;
+        s.lastReply = start;
+        fill(s);
+    }
+
+    epoll_event events[256];
+    char buf[65536];
+    while (nowNs() < deadline) {
+        int n = epoll_wait(ep, events, 256, 10);
+        for (int i = 0; i < n; ++i) {
+            UdpSock& s = socks[events[i].data.u64];
+            while (true) {
+                ssize_t got = recv(s.fd, buf, sizeof(buf), 0);
+                if (got < 0) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) res.recvErrors++;
+                    break;
+                }
+                res.bytesIn += static_cast<uint64_t>(got);
+                uint64_t now = nowNs();
+                if (got >= 17 && buf[0] == 'u') {
+                    char hex[17];
+                    std::memcpy(hex, buf + 1, 16);
+                    hex[16] = '\0';
+                    uint64_t sent = std::strtoull(hex, nullptr, 16);
+                    if (sent <= now) res.latency.add(now - sent);
+                }
+                res.requests++;
+                if (s.inFlight > 0) s.inFlight--;
+                s.lastReply = now;
+            }
+            fill(s);
+        }
+
+        // Датаграммы без ответа слишком долго считаем потерянными и отправляем новые
+        uint64_t now = nowNs();
+        for (UdpSock& s : socks) {
+            if (s.fd < 0 || s.inFlight == 0 || now - s.lastReply < UDP_TIMEOUT_NS) continue;
+            res.lost += s.inFlight;
+            s.inFlight = 0;
+            s.lastReply = now;
+            fill(s);
+        }
+    }
+
+    for (UdpSock& s : socks)
+        if (s.fd >= 0) close(s.fd);
+    close(ep);
+    return res;
+}
+
+/**
+ * Шторм подключений: connect, один эхо запрос, ответ, закрытие
+ * Закрытие с RST (SO_LINGER 0), чтобы не исчерпать локальные порты в TIME_WAIT
+ */
+Result runChurn(const Options& o, uint64_t deadline) {
+    Result res;
+    sockaddr_in addr = resolve(o);
+    const char req[] = "churn\n";
+    char buf[256];
+    timeval timeout{1, 0};
+    linger lg{1, 0};
+
+    while (nowNs() < deadline) {
+        uint64_t start = nowNs();
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            res.connectErrors++;
+            close(fd);
+            continue;
+        }
+        if (send(fd, req, sizeof(req) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req) - 1)) {
+            res.sendErrors++;
+            close(fd);
+            continue;
+        }
+        res.bytesOut += sizeof(req) - 1;
+
+        bool ok = false;
+        while (true) {
+            ssize_t got = recv(fd, buf, sizeof(buf), 0);
+            if (got <= 0) break;
+            res.bytesIn += static_cast<uint64_t>(got);
+            if (std::memchr(buf, '\n', static_cast<size_t>(got))) {
+                ok = true;
+                break;
+            }
+        }
+        close(fd);
+        if (!ok) {
+            res.recvErrors++;
+            continue;
+        }
+        res.latency.add(nowNs() - start);
+        res.requests++;
+    }
+    return res;
+}
+
+/// Сеанс /shm нагрузочного потока
+struct ShmConn {
+    int sock = -1;
+    int requestFd = -1;                 ///< Будит сервер
+    int replyFd = -1;                   ///< Будит нас
+    ShmLayout* layout = nullptr;
+    std::deque<uint64_t> inFlight;
+    std::string tx;
+    size_t txOff = 0;
+};
+
+/**
+ * Открытие сеанса /shm: команда по Unix сокету, в ответе - memfd колец и два eventfd
+ * @return false, если сервер не выдал кольца
+ */
+bool openShm(const Options& o, ShmConn& c) {
+    sockaddr_un ua{};
+    ua.sun_family = AF_UNIX;
+    std::snprintf(ua.sun_path, sizeof(ua.sun_path), "%s", o.unixPath.c_str());
+    c.sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    timeval timeout{2, 0};
+    setsockopt(c.sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(c.sock, (sockaddr*)&ua, sizeof(ua)) < 0 || send(c.sock, "/shm\n", 5, MSG_NOSIGNAL) != 5) return false;
+
+    char reply[64];
+    int fds[3];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    iovec iov{reply, sizeof(reply)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(c.sock, &msg, MSG_CMSG_CLOEXEC);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if (n <= 0 || !cm || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(sizeof(fds))) return false;
+    std::memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+
+    void* mem = mmap(nullptr, sizeof(ShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    c.requestFd = fds[1];
+    c.replyFd = fds[2];
+    if (mem == MAP_FAILED) return false;
+    c.layout = static_cast<ShmLayout*>(mem);
+    return c.layout->magic == ShmLayout::MAGIC && c.layout->capacity == ShmRing::CAPACITY;
+}
+
+void closeShm(ShmConn& c) {
+    if (c.layout) munmap(c.layout, sizeof(ShmLayout));
+    for (int fd : {c.sock, c.requestFd, c.replyFd})
+        if (fd >= 0) close(fd);
+}
+
+/**
+ * Эхо через кольца в разделяемой памяти: запросы пишутся в кольцо, сервер будится
+ * eventfd; ответы ждем на своем eventfd в epoll
+ */
+Result runShm(const Options& o, uint64_t deadline) {
+    Result res;
+    std::string echoLine(o.size > 1 ? o.size - 1 : 1, 'x');
+    echoLine += '\n';
+    size_t depth = static_cast<size_t>(o.depth > 0 ? o.depth : 1);
+    const uint64_t one = 1;
+
+    int ep = epoll_create1(0);
+    std::vector<ShmConn> conns(static_cast<size_t>(o.connections));
+    for (size_t i = 0; i < conns.size(); ++i) {
+        ShmConn& c = conns[i];
+        if (!openShm(o, c)) {
+            res.connectErrors++;
+            closeShm(c);
+            c = ShmConn{};
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.replyFd, &ev);
+    }
+
+    // Дозаполнение конвейера: запись в кольцо запросов и пробуждение сервера
+    auto pump = [&](ShmConn& c) {
+        while (c.inFlight.size() < depth) {
+            c.tx += echoLine;
+            c.inFlight.push_back(nowNs());
+        }
+        ShmRing& ring = c.layout->requests;
+        size_t n = ring.write(c.tx.data() + c.txOff, c.tx.size() - c.txOff);
+        if (n == ShmRing::CORRUPT) {
+            res.sendErrors++;
+            return;
+        }
+        c.txOff += n;
+        res.bytesOut += n;
+        if (c.txOff == c.tx.size()) {
+            c.tx.clear();
+            c.txOff = 0;
+        } else {
+            ring.markWaiting();
+        }
+        if (n > 0 && write(c.requestFd, &one, sizeof(one)) < 0) res.sendErrors++;
+    };
+
+    for (ShmConn& c : conns)
+        if (c.layout) pump(c);
+
+    epoll_event events[256];
+    char buf[65536];
+    uint64_t counter;
+    while (nowNs() < deadline) {
+        int n = epoll_wait(ep, events, 256, 10);
+        for (int i = 0; i < n; ++i) {
+            ShmConn& c = conns[events[i].data.u64];
+            if (read(c.replyFd, &counter, sizeof(counter)) < 0 && errno != EAGAIN) res.recvErrors++;
+
+            ShmRing& ring = c.layout->replies;
+            size_t got;
+            while ((got = ring.read(buf, sizeof(buf))) != 0 && got != ShmRing::CORRUPT) {
+                res.bytesIn += got;
+                uint64_t now = nowNs();
+                for (const char* p = buf; (p = static_cast<const char*>(
+                         std::memchr(p, '\n', static_cast<size_t>(buf + got - p)))); ++p) {
+                    if (c.inFlight.empty()) break;
+                    res.latency.add(now - c.inFlight.front());
+                    c.inFlight.pop_front();
+                    res.requests++;
+                }
+            }
+            if (got == ShmRing::CORRUPT) res.recvErrors++;
+            // Сервер ждал места под ответы
+            if (ring.takeWaiting() && write(c.requestFd, &one, sizeof(one)) < 0) res.sendErrors++;
+            pump(c);
+        }
+    }
+
+    for (ShmConn& c : conns) closeShm(c);
+    close(ep);
+    return res;
+}
+
+/**
+ * Прогон одной фазы во всех потоках
+ * @return JSON объект с результатом
+ */
+std::string runPhase(const Options& o) {
+    if (o.scenario != "echo" && o.scenario != "pipeline" && o.scenario != "commands" &&
+        o.scenario != "udp" && o.scenario != "churn" && o.scenario != "shm") {
+        std::fprintf(stderr, "Error: Unknown scenario: %s\n", o.scenario.c_str());
+        exit(1);
+    }
+
+    uint64_t start = nowNs();
+    uint64_t deadline = start + static_cast<uint64_t>(o.duration * 1e9);
+    std::vector<Result> results(static_cast<size_t>(o.threads));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < o.threads; ++t) {
+        threads.emplace_back([&, t] {
+            Result& r = results[static_cast<size_t>(t)];
+            if (o.scenario == "udp") r = runUdp(o, deadline);
+            else if (o.scenario == "churn") r = runChurn(o, deadline);
+            else if (o.scenario == "shm") r = runShm(o, deadline);
+            else r = runTcp(o, deadline, static_cast<unsigned>(t + 1));
+        });
+    }
+    for (auto& t : threads) t.join();
+    double elapsed = static_cast<double>(nowNs() - start) / 1e9;
+
+    Result total;
+    for (const Result& r : results) total.merge(r);
+
+    auto us = [&](double p) { return static_cast<double>(total.latency.percentile(p)) / 1e3; };
+    char json[1024];
+    std::snprintf(json, sizeof(json),
+        "{\"scenario\":\"%s\",\"threads\":%d,\"connections\":%d,\"depth\":%d,\"size\":%zu,"
+        "\"duration_s\":%.3f,\"requests\":%llu,\"throughput_rps\":%.1f,"
+        "\"bytes_out\":%llu,\"bytes_in\":%llu,"
+        "\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},"
+        "\"errors\":{\"connect\":%llu,\"send\":%llu,\"recv\":%llu,\"lost\":%llu}}",
+        o.scenario.c_str(), o.threads, o.connections, o.depth, o.size, elapsed,
+        static_cast<unsigned long long>(total.requests), static_cast<double>(total.requests) / elapsed,
+        static_cast<unsigned long long>(total.bytesOut), static_cast<unsigned long long>(total.bytesIn),
+        us(0.5), us(0.99), us(0.999), static_cast<double>(total.latency.max) / 1e3,
+        static_cast<unsigned long long>(total.connectErrors), static_cast<unsigned long long>(total.sendErrors),
+        static_cast<unsigned long long>(total.recvErrors), static_cast<unsigned long long>(total.lost));
+    return json;
+}
+
+/**
+ * Значение поля плоского JSON объекта (строка или число)
+ * @return false, если поля нет
+ */
+bool jsonField(const std::string& line, const std::string& key, std::string& value) {
+    size_t pos = line.find("\"" + key + "\"");
+    if (pos == std::string::npos) return false;
+    pos = line.find(':', pos + key.size() + 2);
+    if (pos == std::string::npos) return false;
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string::npos) return false;
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+/**
+ * Применение параметра командной строки или поля фазы
+ * @return false для неизвестного параметра
+ */
+bool applyOption(Options& o, const std::string& key, const std::string& value) {
+    if (key == "host") o.host = value;
+    else if (key == "port") o.port = std::atoi(value.c_str());
+    else if (key == "unix") o.unixPath = value;
+    else if (key == "scenario") o.scenario = value;
+    else if (key == "threads") o.threads = std::max(1, std::atoi(value.c_str()));
+    else if (key == "connections") o.connections = std::max(1, std::atoi(value.c_str()));
+    else if (key == "depth") o.depth = std::max(1, std::atoi(value.c_str()));
+    else if (key == "size") o.size = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "duration") o.duration = std::atof(value.c_str());
+    else if (key == "mix") o.mix = value;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options base;
+    std::string replay;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0 || i + 1 >= argc) {
+            std::fprintf(stderr, "Usage: %s [--host A] [--port P] [--unix PATH] [--scenario echo|pipeline|commands|udp|churn|shm] "
+                                 "[--threads N] [--connections N] [--depth N] [--size BYTES] [--duration SEC] "
+                                 "[--mix time:1,stats:1,echo:8] [--replay FILE]\n", argv[0]);
+            return 1;
+        }
+        std::string key = arg.substr(2);
+        std::string value = argv[++i];
+        if (key == "replay") replay = value;
+        else if (!applyOption(base, key, value)) {
+            std::fprintf(stderr, "Error: Unknown option: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    if (replay.empty()) {
+        std::printf("%s\n", runPhase(base).c_str());
+        return 0;
+    }
+
+    // Фазы из JSON lines: поля фазы переопределяют параметры командной строки
+    std::ifstream in(replay);
+    if (!in) {
+        std::perror(replay.c_str());
+        return 1;
+    }
+    static const char* const keys[] = {"host", "port", "unix", "scenario", "threads", "connections",
+                                       "depth", "size", "duration", "mix"};
+    std::string line;
+    bool first = true;
+    std::printf("[");
+    while (std::getline(in, line)) {
+        std::string value;
+        if (!jsonField(line, "scenario", value)) continue;
+        Options o = base;
+        for (const char* key : keys)
+            if (jsonField(line, key, value)) applyOption(o, key, value);
+        std::printf("%s\n%s", first ? "" : ",", runPhase(o).c_str());
+        std::fflush(stdout);
+        first = false;
+    }
+    std::printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "../EpollServer.h"
+#include "../Frame.h"
+#include "../Metrics.h"
+#include "../ThreadPool.h"
+#include "../Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Микробенчмарки внутренних компонентов сервера
+ * Все метрики - наносекунды на операцию (меньше - лучше), медиана нескольких прогонов.
+ * Запуск: tt_microbench [--filter SUBSTR] [--runs N] [--out FILE]
+ *                       [--baseline FILE] [--threshold FRACTION]
+ * С --baseline сравнивает результаты с сохраненными и завершается с кодом 1,
+ * если хотя бы одна метрика хуже базовой больше чем на threshold (по умолчанию 0.10)
+ */
+
+namespace {
+
+/// Параметры прогона
+struct Options {
+    std::string filter;
+    int runs = 5;
+    double minTime = 0.2;       ///< Минимальная длительность одного прогона, секунды
+    std::string out;
+    std::string baseline;
+    double threshold = 0.10;
+};
+
+using Results = std::map<std::string, double>;
+
+/**
+ * Замер функции: повторяет вызовы, пока прогон не займет minTime
+ * @param ops Операций в одном вызове fn
+ * @return Медиана нс на операцию по прогонам
+ */
+double measure(const Options& o, size_t ops, const std::function<void()>& fn) {
+    fn();   // Прогрев кэшей и аллокаций
+
+    std::vector<double> samples;
+    for (int run = 0; run < o.runs; ++run) {
+        size_t calls = 0;
+        uint64_t start = Metrics::nowNs();
+        uint64_t elapsed;
+        do {
+            fn();
+            ++calls;
+            elapsed = Metrics::nowNs() - start;
+        } while (static_cast<double>(elapsed) < o.minTime * 1e9);
+        samples.push_back(static_cast<double>(elapsed) / static_cast<double>(calls * ops));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+/**
+ * Пропускная способность enqueue: производитель ставит пачку задач и ждет их выполнения
+ */
+double benchPoolEnqueue(const Options& o, size_t threads) {
+    constexpr size_t BATCH = 10000;
+    ThreadPool pool(threads);
+    std::atomic<size_t> done{0};
+    return measure(o, BATCH, [&] {
+        done.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < BATCH; ++i)
+            pool.enqueue([&done] { done.fetch_add(1, std::memory_order_release); });
+        while (done.load(std::memory_order_acquire) < BATCH) std::this_thread::yield();
+    });
+}
+
+/**
+ * Задержка пробуждения: от enqueue в простаивающий пул до начала выполнения задачи
+ * @param spinNs Опрос очередей перед засыпанием (режим --latency-mode); больше паузы между задачами -
+ *        поток не успевает уснуть
+ * @return Медиана, нс
+ */
+double benchPoolWakeup(const Options& o, uint64_t spinNs) {
+    ThreadPool pool(1, spinNs);
+    std::vector<uint64_t> samples;
+    std::atomic<uint64_t> startedAt{0};
+    for (int i = 0; i < 50 * o.runs; ++i) {
+        // Даем потоку уснуть, чтобы измерить именно пробуждение
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        startedAt.store(0, std::memory_order_relaxed);
+        uint64_t t0 = Metrics::nowNs();
+        pool.enqueue([&startedAt] { startedAt.store(Metrics::nowNs(), std::memory_order_release); });
+        uint64_t t1;
+        while ((t1 = startedAt.load(std::memory_order_acquire)) == 0) std::this_thread::yield();
+        samples.push_back(t1 - t0);
+    }
+    std::sort(samples.begin(), samples.end());
+    return static_cast<double>(samples[samples.size() / 2]);
+}
+
+/**
+ * Разбор входного буфера как в handleTcpRead: depth строк длиной lineLen за один recv
+ * @return нс на строку
+ */
+double benchFraming(const Options& o, EpollServer& server, size_t lineLen, size_t depth) {
+    std::string chunk;
+    for (size_t i = 0; i < depth; ++i) {
+        chunk.append(lineLen - 1, 'a' + static_cast<char>(i % 26));
+        chunk += '\n';
+    }
+
+    Client c{};
+    return measure(o, depth, [&] {
+        size_t off = 0;
+        while (off < chunk.size()) {
+            size_t room;
+            char* dst = c.buffer.prepare(4096, room);
+            size_t n = std::min(room, chunk.size() - off);
+            std::memcpy(dst, chunk.data() + off, n);
+            c.buffer.commit(n);
+            off += n;
+            server.processInput(c);
+        }
+        c.out.consume(c.out.pending());
+    });
+}
+
+/**
+ * Разбор двоичных кадров эха как в handleTcpRead: depth кадров с нагрузкой payload байт
+ * @return нс на кадр
+ */
+double benchFrames(const Options& o, EpollServer& server, size_t payload, size_t depth) {
+    std::string chunk;
+    for (size_t i = 0; i < depth; ++i) {
+        char header[Frame::HEADER];
+        Frame::writeHeader(header, Frame::ECHO, static_cast<uint32_t>(payload));
+        chunk.append(header, sizeof(header));
+        chunk.append(payload, 'a' + static_cast<char>(i % 26));
+    }
+
+    Client c{};
+    c.protocol = Client::Protocol::Binary;
+    return measure(o, depth, [&] {
+        size_t off = 0;
+        while (off < chunk.size()) {
+            size_t room;
+            char* dst = c.buffer.prepare(EpollServer::recvHint(c), room);
+            size_t n = std::min(room, chunk.size() - off);
+            std::memcpy(dst, chunk.data() + off, n);
+            c.buffer.commit(n);
+            off += n;
+            server.processInput(c);
+        }
+        c.out.consume(c.out.pending());
+    });
+}
+
+/**
+ * Разбор и выполнение команд по TCP (строка -> ответ в очереди)
+ */
+double benchTcpCommand(const Options& o, EpollServer& server, const std::string& line) {
+    constexpr size_t DEPTH = 64;
+    std::string chunk;
+    for (size_t i = 0; i < DEPTH; ++i) chunk += line;
+
+    Client c{};
+    return measure(o, DEPTH, [&] {
+        size_t room;
+        char* dst = c.buffer.prepare(chunk.size(), room);
+        std::memcpy(dst, chunk.data(), chunk.size());
+        c.buffer.commit(chunk.size());
+        server.processInput(c);
+        c.out.consume(c.out.pending());
+    });
+}
+
+/**
+ * Выполнение команды UDP датаграммы
+ */
+double benchUdpCommand(const Options& o, EpollServer& server, const std::string& msg) {
+    sockaddr_in peer{};
+    peer.sin_family = AF_INET;
+    peer.sin_addr.s_addr = htonl(0x7f000001);
+    peer.sin_port = htons(40000);
+    std::string reply;
+    Reactor r;
+    return measure(o, 1, [&] { server.handleDatagram(r, msg, peer, reply); });
+}
+
+/**
+ * Чтение результатов из плоского JSON объекта {"name": value, ...}
+ */
+Results readResults(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::perror(path.c_str());
+        exit(2);
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+
+    Results res;
+    size_t pos = 0;
+    while ((pos = text.find('"', pos)) != std::string::npos) {
+        size_t end = text.find('"', pos + 1);
+        if (end == std::string::npos) break;
+        std::string name = text.substr(pos + 1, end - pos - 1);
+        size_t colon = text.find(':', end);
+        if (colon == std::string::npos) break;
+        res[name] = std::strtod(text.c_str() + colon + 1, nullptr);
+        pos = text.find_first_of(",}", colon);
+    }
+    return res;
+}
+
+std::string toJson(const Results& res) {
+    std::string out = "{\n";
+    char line[160];
+    size_t i = 0;
+    for (auto& [name, value] : res) {
+        std::snprintf(line, sizeof(line), "  \"%s\": %.2f%s\n", name.c_str(), value,
+                      ++i < res.size() ? "," : "");
+        out += line;
+    }
+    return out + "}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) o.filter = argv[++i];
+        else if (arg == "--runs" && i + 1 < argc) o.runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-time" && i + 1 < argc) o.minTime = std::atof(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) o.out = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) o.baseline = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) o.threshold = std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "Usage: %s [--filter SUBSTR] [--runs N] [--min-time SEC] [--out FILE] "
+                                 "[--baseline FILE] [--threshold FRACTION]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Сервер без пула и сокетов: используются только разбор и команды
+    ServerConfig config;
+    config.threads = 0;
+    EpollServer server(config);
+
+    std::vector<std::pair<std::string, std::function<double()>>> benches = {
+        {"pool_enqueue_1t_ns", [&] { return benchPoolEnqueue(o, 1); }},
+        {"pool_enqueue_4t_ns", [&] { return benchPoolEnqueue(o, 4); }},
+        {"pool_wakeup_p50_ns", [&] { return benchPoolWakeup(o, 0); }},
+        {"pool_wakeup_spin_p50_ns", [&] { return benchPoolWakeup(o, 1000000); }},
+        {"framing_16b_x1_ns", [&] { return benchFraming(o, server, 16, 1); }},
+        {"framing_16b_x64_ns", [&] { return benchFraming(o, server, 16, 64); }},
+        {"framing_128b_x16_ns", [&] { return benchFraming(o, server, 128, 16); }},
+        {"framing_1k_x8_ns", [&] { return benchFraming(o, server, 1024, 8); }},
+        {"framing_8k_x2_ns", [&] { return benchFraming(o, server, 8192, 2); }},
+        {"frames_16b_x64_ns", [&] { return benchFrames(o, server, 16, 64); }},
+        {"frames_8k_x2_ns", [&] { return benchFrames(o, server, 8192, 2); }},
+        {"frames_1m_x1_ns", [&] { return benchFrames(o, server, 1024 * 1024, 1); }},
+        {"dispatch_tcp_time_ns", [&] { return benchTcpCommand(o, server, "/time\n"); }},
+        {"dispatch_tcp_unknown_ns", [&] { return benchTcpCommand(o, server, "/unknown\n"); }},
+        {"dispatch_udp_echo_ns", [&] { return benchUdpCommand(o, server, "hello"); }},
+        {"dispatch_udp_unknown_ns", [&] { return benchUdpCommand(o, server, "/unknown"); }},
+        {"now_string_ns", [&] { return measure(o, 1, [] { nowString(); }); }},
+        {"stats_ns", [&] { return benchUdpCommand(o, server, "/stats"); }},
+    };
+
+    Results results;
+    for (auto& [name, run] : benches) {
+        if (!o.filter.empty() && name.find(o.filter) == std::string::npos) continue;
+        results[name] = run();
+        std::fprintf(stderr, "%-26s %12.2f\n", name.c_str(), results[name]);
+    }
+
+    std::string json = toJson(results);
+    std::fputs(json.c_str(), stdout);
+    if (!o.out.empty()) std::ofstream(o.out) << json;
+
+    if (o.baseline.empty()) return 0;
+
+    // Сравнение с базовыми результатами: все метрики - время, рост считается регрессией
+    Results base = readResults(o.baseline);
+    bool regressed = false;
+    for (auto& [name, value] : results) {
+        auto it = base.find(name);
+        if (it == base.end() || it->second <= 0) continue;
+        double change = value / it->second - 1.0;
+        bool bad = change > o.threshold;
+        regressed |= bad;
+        std::fprintf(stderr, "%-26s %12.2f -> %12.2f  %+6.1f%%%s\n", name.c_str(), it->second, value,
+                     change * 100.0, bad ? "  REGRESSION" : "");
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#include "../ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Сравнение пулов потоков под конкуренцией
+ * Прежний пул (одна очередь std::function под мьютексом) против пула
+ * с очередями на поток: enqueue с перехватом работы и enqueueFor с привязкой к ключу.
+ * Запуск: tt_poolbench [TASKS] [MAX_THREADS]
+ */
+
+namespace {
+
+/**
+ * Прежняя реализация ThreadPool - эталон для сравнения
+ */
+class MutexPool {
+public:
+    explicit MutexPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(queueMutex_);
+                        condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                        if (stop_ && tasks_.empty()) return;
+                        task = std::move(tasks_.front());
+                        tasks_.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~MutexPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+
+    void enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            tasks_.push(std::move(task));
+        }
+        condition_.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex queueMutex_;
+    std::condition_variable condition_;
+    bool stop_ = false;
+};
+
+/// Имитация замыкания из EpollServer::dispatchLoop: [this, &r, fd, ev]
+struct Payload {
+    std::atomic<size_t>* done;
+    void* reactor;
+    int fd;
+    uint32_t events;
+};
+
+/**
+ * Прогон одного сценария
+ * @param producers количество потоков, ставящих задачи
+ * @param tasks общее количество задач
+ * @param submit функция постановки задачи (номер задачи, счетчик выполненных)
+ * @return миллионов задач в секунду
+ */
+template <typename Submit>
+double measure(size_t producers, size_t tasks, Submit submit) {
+    std::atomic<size_t> done{0};
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = p; i < tasks; i += producers) submit(i, done);
+        });
+    }
+    for (auto& t : threads) t.join();
+    while (done.load(std::memory_order_acquire) < tasks) std::this_thread::yield();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(tasks) / elapsed.count() / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t tasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    constexpr size_t KEYS = 1024;   // Количество "соединений" для enqueueFor
+
+    std::printf("%-8s %-10s %12s %12s %12s   (Mtasks/s)\n",
+                "threads", "producers", "mutex", "stealing", "affinity");
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        for (size_t producers : {size_t{1}, size_t{4}}) {
+            double legacy;
+            {
+                MutexPool pool(threads);
+                legacy = measure(producers, tasks, [&](size_t i, std::atomic<size_t>& done) {
+                    Payload p{&done, nullptr, static_cast<int>(i % KEYS), 1};
+                    pool.enqueue([p] { p.done->fetch_add(1, std::memory_order_release); });
+                });
+            }
+
+            double stealing;
+            {
+                ThreadPool pool(threads);
+                stealing = measure(producers, tasks, [&](size_t i, std::atomic<size_t>& done) {
+                    Payload p{&done, nullptr, static_cast<int>(i % KEYS), 1};
+                    pool.enqueue([p] { p.done->fetch_add(1, std::memory_order_release); });
+                });
+            }
+
+            double affinity;
+            {
+                ThreadPool pool(threads);
+                affinity = measure(producers, tasks, [&](size_t i, std::atomic<size_t>& done) {
+                    Payload p{&done, nullptr, static_cast<int>(i % KEYS), 1};
+                    pool.enqueueFor(static_cast<size_t>(p.fd),
+                                    [p] { p.done->fetch_add(1, std::memory_order_release); });
+                });
+            }
+
+            std::printf("%-8zu %-10zu %12.2f %12.2f %12.2f\n",
+                        threads, producers, legacy, stealing, affinity);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
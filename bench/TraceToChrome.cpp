@@ -0,0 +1,183 @@
+#include "../FlightRecorder.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/**
+ * Перевод дампа бортового самописца (SIGUSR1, /trace) в Chrome trace JSON
+ * для chrome://tracing и ui.perfetto.dev. Пара wait_begin/wait_end становится
+ * интервалом epoll_wait, dequeue/task_done - интервалом задачи пула, ожидание задачи
+ * в очереди - асинхронным интервалом queued; остальные события - отметки с fd и аргументом.
+ * Запуск: tt_trace2chrome DUMP [OUT.json] (без OUT - в stdout)
+ */
+
+namespace {
+
+using Event = FlightRecorder::Event;
+
+struct Thread {
+    FlightRecorder::ThreadHeader header;
+    const FlightRecorder::Record* records;
+};
+
+/**
+ * Разбор файла дампа
+ * @return false, если файл поврежден или другой версии
+ */
+bool parse(const std::string& data, FlightRecorder::FileHeader& header, std::vector<Thread>& threads) {
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != FlightRecorder::FileHeader::MAGIC || header.version != FlightRecorder::FileHeader::VERSION ||
+        header.recordSize != sizeof(FlightRecorder::Record) || header.ticksPerNs <= 0)
+        return false;
+
+    size_t at = sizeof(header);
+    for (uint32_t i = 0; i < header.threads; ++i) {
+        Thread t;
+        if (data.size() - at < sizeof(t.header)) return false;
+        std::memcpy(&t.header, data.data() + at, sizeof(t.header));
+        at += sizeof(t.header);
+        size_t bytes = size_t{t.header.records} * sizeof(FlightRecorder::Record);
+        if (data.size() - at < bytes) return false;
+        t.records = reinterpret_cast<const FlightRecorder::Record*>(data.data() + at);
+        at += bytes;
+        threads.push_back(t);
+    }
+    return true;
+}
+
+/// Запись событий одного потока; ts - микросекунды от первой записи дампа
+class Writer {
+public:
+    Writer(FILE* out, double ticksPerUs, uint64_t origin) : out_(out), ticksPerUs_(ticksPerUs), origin_(origin) {}
+
+    double us(uint64_t tsc) const { return static_cast<double>(tsc - origin_) / ticksPerUs_; }
+
+    void thread(uint32_t tid) {
+        emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", tid, tid);
+    }
+
+    void slice(uint32_t tid, const char* name, double ts, double dur, const char* argName, uint64_t arg) {
+        emit("{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"%s\":%llu}}",
+             name, tid, ts, dur, argName, static_cast<unsigned long long>(arg));
+    }
+
+    void queued(uint32_t tid, double begin, double end) {
+        ++asyncId_;
+        emit("{\"ph\":\"b\",\"cat\":\"queue\",\"name\":\"queued\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+             asyncId_, tid, begin);
+        emit("{\"ph\":\"e\",\"cat\":\"queue\",\"name\":\"queued\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+             asyncId_, tid, end);
+    }
+
+    void instant(uint32_t tid, Event event, double ts, int fd, uint32_t arg) {
+        emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"fd\":%d,\"arg\":%u}}",
+             FlightRecorder::name(event), tid, ts, fd, arg);
+    }
+
+private:
+    template <typename... Args>
+    void emit(const char* fmt, Args... args) {
+        std::fputs(first_ ? "\n" : ",\n", out_);
+        first_ = false;
+        std::fprintf(out_, fmt, args...);
+    }
+
+    FILE* out_;
+    double ticksPerUs_;
+    uint64_t origin_;
+    unsigned long long asyncId_ = 0;
+    bool first_ = true;
+};
+
+/**
+ * События одного потока: парные события складываются в интервалы
+ */
+void convert(Writer& w, const Thread& t) {
+    uint32_t tid = t.header.tid;
+    w.thread(tid);
+    const FlightRecorder::Record* waitBegin = nullptr;
+    const FlightRecorder::Record* taskBegin = nullptr;
+
+    for (uint32_t i = 0; i < t.header.records; ++i) {
+        const FlightRecorder::Record& rec = t.records[i];
+        auto event = static_cast<Event>(rec.eventArg >> 24);
+        uint32_t arg = rec.eventArg & FlightRecorder::ARG_MAX;
+        double ts = w.us(rec.tsc);
+
+        switch (event) {
+            case Event::WaitBegin:
+                waitBegin = &rec;
+                break;
+            case Event::WaitEnd:
+                if (waitBegin) w.slice(tid, "epoll_wait", w.us(waitBegin->tsc), ts - w.us(waitBegin->tsc), "events", arg);
+                else w.instant(tid, event, ts, rec.fd, arg);
+                waitBegin = nullptr;
+                break;
+            case Event::Dequeue:
+                taskBegin = &rec;
+                w.queued(tid, ts - arg, ts);
+                break;
+            case Event::TaskDone:
+                if (taskBegin)
+                    w.slice(tid, "task", w.us(taskBegin->tsc), ts - w.us(taskBegin->tsc), "queued_us",
+                            taskBegin->eventArg & FlightRecorder::ARG_MAX);
+                taskBegin = nullptr;
+                break;
+            default:
+                w.instant(tid, event, ts, rec.fd, arg);
+                break;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "Usage: %s DUMP [OUT.json]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::perror(argv[1]);
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    FlightRecorder::FileHeader header;
+    std::vector<Thread> threads;
+    if (!parse(data, header, threads)) {
+        std::fprintf(stderr, "%s: not a flight recorder dump\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (argc == 3 && !(out = std::fopen(argv[2], "w"))) {
+        std::perror(argv[2]);
+        return 1;
+    }
+
+    // Начало отсчета - самая ранняя запись всех потоков
+    uint64_t origin = header.dumpTsc;
+    size_t total = 0;
+    for (const Thread& t : threads) {
+        if (t.header.records > 0 && t.records[0].tsc < origin) origin = t.records[0].tsc;
+        total += t.header.records;
+    }
+
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dump_realtime_ns\":\"%llu\",\"records\":\"%zu\"},"
+                      "\"traceEvents\":[",
+                 static_cast<unsigned long long>(header.dumpRealtimeNs), total);
+    Writer w(out, header.ticksPerNs * 1000.0, origin);
+    for (const Thread& t : threads) convert(w, t);
+    std::fputs("\n]}\n", out);
+
+    if (out != stdout) std::fclose(out);
+    std::fprintf(stderr, "%zu records from %zu threads\n", total, threads.size());
+    return 0;
+}
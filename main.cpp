@@ -1,25 +1,29 @@
 #include "EpollServer.h"
+#include "FlightRecorder.h"
+#include "Utils.h"
 #include <iostream>
 
 int main(int argc, char* argv[]) {
     // Проверка минимального количества аргументов
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <port> [--threads N] [--shutdown-token TOKEN]\n";
+        std::cerr << "Usage: " << argv[0] << " <port> [--threads N] [--shutdown-token TOKEN] [--reactors N] [--high-water BYTES] [--backend epoll|uring] [--metrics-port PORT] [--udp-gso] [--udp-peers exact|hll] [--udp-peer-ttl SECONDS] [--udp-peer-max N] [--idle-timeout SEC] [--line-timeout SEC] [--max-lifetime SEC] [--accept-rate N] [--accept-burst N] [--udp-rate N] [--udp-burst N] [--max-line BYTES] [--max-frame BYTES] [--max-connections N] [--max-inflight N] [--latency-mode] [--spin-us N] [--cpu-list LIST] [--handoff PATH] [--drain-timeout SEC] [--unix PATH|off] [--trace-window SEC] [--trace-dir DIR] [--log-level debug|info|warn|error] [--log-dir DIR]\n";
         return 1;
     }
 
     char* end;
+    ServerConfig config;
+
     // Парсинг порта из первого аргумента
-    int port = std::strtol(argv[1], &end, 10);
+    long port = std::strtol(argv[1], &end, 10);
     // Валидация порта
     if (*end != '\0' || port <= 0 || port > 65535) {
         std::cerr << "Error: Invalid port number: " << argv[1] << "\n";
         return 1;
     }
+    config.port = static_cast<int>(port);
 
     // Установка значений по умолчанию
-    int threads = std::thread::hardware_concurrency(); // Количество ядер процессора
-    std::string token; // Токен для команды shutdown
+    config.threads = static_cast<int>(std::thread::hardware_concurrency()); // Количество ядер процессора
 
     // Обработка опциональных аргументов
     for (int i = 2; i < argc; ++i) {
@@ -27,22 +31,211 @@ int main(int argc, char* argv[]) {
 
         // Обработка параметра --threads
         if (arg == "--threads" && i + 1 < argc) {
-            threads = std::strtol(argv[++i], &end, 10);
+            config.threads = static_cast<int>(std::strtol(argv[++i], &end, 10));
             // Валидация количества потоков
-            if (*end != '\0' || threads <= 0) {
+            if (*end != '\0' || config.threads <= 0) {
                 std::cerr << "Error: Invalid thread count: " << argv[i] << "\n";
                 return 1;
             }
         }
         // Обработка параметра --shutdown-token
         else if (arg == "--shutdown-token" && i + 1 < argc) {
-            token = argv[++i]; // Сохраняем токен для завершения работы
+            config.shutdownToken = argv[++i]; // Сохраняем токен для завершения работы
+        }
+        // Обработка параметра --reactors
+        else if (arg == "--reactors" && i + 1 < argc) {
+            config.reactors = static_cast<int>(std::strtol(argv[++i], &end, 10));
+            // Валидация количества реакторов
+            if (*end != '\0' || config.reactors <= 0) {
+                std::cerr << "Error: Invalid reactor count: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        // Обработка параметра --high-water
+        else if (arg == "--high-water" && i + 1 < argc) {
+            long long bytes = std::strtoll(argv[++i], &end, 10);
+            // Валидация порога очереди ответов
+            if (*end != '\0' || bytes <= 0) {
+                std::cerr << "Error: Invalid high-water mark: " << argv[i] << "\n";
+                return 1;
+            }
+            config.outHighWater = static_cast<size_t>(bytes);
+        }
+        // Обработка параметра --backend (допускается и форма --backend=uring)
+        else if ((arg == "--backend" && i + 1 < argc) || arg.rfind("--backend=", 0) == 0) {
+            std::string name = arg == "--backend" ? argv[++i] : arg.substr(10);
+            if (name == "epoll") {
+                config.backend = ServerConfig::Backend::Epoll;
+            } else if (name == "uring" || name == "io_uring") {
+                config.backend = ServerConfig::Backend::Uring;
+            } else {
+                std::cerr << "Error: Unknown backend: " << name << "\n";
+                return 1;
+            }
+        }
+        // Обработка параметра --log-level
+        else if (arg == "--log-level" && i + 1 < argc) {
+            if (!Logger::parseLevel(argv[++i], config.logLevel)) {
+                std::cerr << "Error: Unknown log level: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        // Обработка параметра --log-dir
+        else if (arg == "--log-dir" && i + 1 < argc) {
+            config.logDir = argv[++i];
+        }
+        // Обработка параметра --metrics-port
+        else if (arg == "--metrics-port" && i + 1 < argc) {
+            long metricsPort = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || metricsPort <= 0 || metricsPort > 65535) {
+                std::cerr << "Error: Invalid metrics port: " << argv[i] << "\n";
+                return 1;
+            }
+            config.metricsPort = static_cast<int>(metricsPort);
+        }
+        // Обработка параметра --udp-gso
+        else if (arg == "--udp-gso") {
+            config.udpGso = true;
+        }
+        // Обработка параметра --udp-peers
+        else if (arg == "--udp-peers" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "exact") {
+                config.udpPeers = UdpPeerTracker::Mode::Exact;
+            } else if (mode == "hll") {
+                config.udpPeers = UdpPeerTracker::Mode::Approx;
+            } else {
+                std::cerr << "Error: Unknown UDP peer mode: " << mode << "\n";
+                return 1;
+            }
+        }
+        // Обработка параметра --udp-peer-ttl
+        else if (arg == "--udp-peer-ttl" && i + 1 < argc) {
+            long ttl = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || ttl <= 0 || ttl > 86400) {
+                std::cerr << "Error: Invalid UDP peer TTL: " << argv[i] << "\n";
+                return 1;
+            }
+            config.udpPeerTtl = static_cast<uint32_t>(ttl);
+        }
+        // Обработка параметра --udp-peer-max
+        else if (arg == "--udp-peer-max" && i + 1 < argc) {
+            long max = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || max <= 0) {
+                std::cerr << "Error: Invalid UDP peer limit: " << argv[i] << "\n";
+                return 1;
+            }
+            config.udpPeerMax = static_cast<size_t>(max);
+        }
+        // Обработка таймаутов соединений --idle-timeout, --line-timeout, --max-lifetime (0 - выключен)
+        else if ((arg == "--idle-timeout" || arg == "--line-timeout" || arg == "--max-lifetime") && i + 1 < argc) {
+            long seconds = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || seconds < 0 || seconds > 30L * 86400) {
+                std::cerr << "Error: Invalid " << arg.substr(2) << ": " << argv[i] << "\n";
+                return 1;
+            }
+            uint32_t& target = arg == "--idle-timeout" ? config.idleTimeout
+                             : arg == "--line-timeout" ? config.lineTimeout : config.maxLifetime;
+            target = static_cast<uint32_t>(seconds);
+        }
+        // Лимиты источников --accept-rate, --accept-burst, --udp-rate, --udp-burst (в секунду / штук, 0 - нет)
+        else if ((arg == "--accept-rate" || arg == "--accept-burst" || arg == "--udp-rate" || arg == "--udp-burst") &&
+                 i + 1 < argc) {
+            double value = std::strtod(argv[++i], &end);
+            if (*end != '\0' || value < 0) {
+                std::cerr << "Error: Invalid " << arg.substr(2) << ": " << argv[i] << "\n";
+                return 1;
+            }
+            double& target = arg == "--accept-rate" ? config.acceptRate
+                           : arg == "--accept-burst" ? config.acceptBurst
+                           : arg == "--udp-rate" ? config.udpRate : config.udpBurst;
+            target = value;
+        }
+        // Предел кадра обязателен: длину кадра задает клиент
+        else if (arg == "--max-frame" && i + 1 < argc) {
+            long long value = std::strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || value < 1 || value > 1073741824) {
+                std::cerr << "Error: Invalid max-frame: " << argv[i] << "\n";
+                return 1;
+            }
+            config.maxFrame = static_cast<size_t>(value);
+        }
+        // Пределы --max-line (байт), --max-connections, --max-inflight (0 - без ограничения)
+        else if ((arg == "--max-line" || arg == "--max-connections" || arg == "--max-inflight") &&
+                 i + 1 < argc) {
+            long long value = std::strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0) {
+                std::cerr << "Error: Invalid " << arg.substr(2) << ": " << argv[i] << "\n";
+                return 1;
+            }
+            size_t& target = arg == "--max-line" ? config.maxLine
+                           : arg == "--max-connections" ? config.maxConnections : config.maxInflight;
+            target = static_cast<size_t>(value);
+        }
+        // Режим низкой задержки: опрос сокетов и очередей перед сном
+        else if (arg == "--latency-mode") {
+            config.latencyMode = true;
+        }
+        else if (arg == "--spin-us" && i + 1 < argc) {
+            long value = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 1000000) {
+                std::cerr << "Error: Invalid spin-us: " << argv[i] << "\n";
+                return 1;
+            }
+            config.spinUs = static_cast<uint32_t>(value);
+        }
+        // Ядра для реакторов и потоков пула, например 2,4-7
+        else if (arg == "--cpu-list" && i + 1 < argc) {
+            if (!parseCpuList(argv[++i], config.cpuList)) {
+                std::cerr << "Error: Invalid cpu-list: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        // Обновление без простоя: передача сокетов и соединений через Unix сокет
+        else if (arg == "--handoff" && i + 1 < argc) {
+            config.handoffPath = argv[++i];
+        }
+        else if (arg == "--drain-timeout" && i + 1 < argc) {
+            long seconds = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || seconds < 0 || seconds > 86400) {
+                std::cerr << "Error: Invalid drain-timeout: " << argv[i] << "\n";
+                return 1;
+            }
+            config.drainTimeout = static_cast<uint32_t>(seconds);
+        }
+        // Клиенты той же машины: Unix сокет и кольца в разделяемой памяти
+        else if (arg == "--unix" && i + 1 < argc) {
+            std::string path = argv[++i];
+            config.unixPath = path == "off" ? std::string() : path;
+        }
+        // Бортовой самописец: окно дампа и каталог файлов
+        else if (arg == "--trace-window" && i + 1 < argc) {
+            long seconds = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || seconds < 0 || seconds > 3600) {
+                std::cerr << "Error: Invalid trace-window: " << argv[i] << "\n";
+                return 1;
+            }
+            config.traceWindow = static_cast<uint32_t>(seconds);
+        }
+        else if (arg == "--trace-dir" && i + 1 < argc) {
+            config.traceDir = argv[++i];
         }
     }
 
+    // Самописец запускается до всех потоков: они наследуют маску с заблокированным SIGUSR1
+    FlightRecorder::start(config.traceWindow, config.traceDir);
+
+    // Фоновый вывод лога; останавливается после сервера, чтобы дописать последние сообщения
+    Logger::start(config.logLevel, config.logDir);
+
     // Создание и запуск epoll сервера
-    EpollServer server(port, threads, token);
-    server.run();
+    {
+        EpollServer server(config);
+        server.run();
+    }
+
+    FlightRecorder::stop();
+    Logger::stop();
 
     return 0;
 }
\ No newline at end of file